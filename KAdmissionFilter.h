@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace KamaCache {
+
+// "一次性访问"准入过滤器：一对轮换的布隆过滤器，key 在一个窗口内第二次出现时才允许进入缓存，
+// 从而挡住只出现一次的冷数据和扫描流量。位数组用原子字存放，检查与置位都不加锁，
+// 可以被多个分片共享。每插入 window 个新 key 轮换一次：清空较旧的过滤器并把它作为新的当前过滤器
+class KBloomAdmissionFilter {
+public:
+    // window：一个窗口内记录的 key 个数；bitsPerKey 与 hashCount 决定误判率（默认约 1.7%）
+    explicit KBloomAdmissionFilter(size_t window, size_t bitsPerKey = 10, int hashCount = 3)
+        : window_(window > 0 ? window : 1), hashCount_(hashCount > 0 ? hashCount : 1) {
+        size_t words = (window_ * bitsPerKey + 63) / 64;
+        bitMask_ = 1;
+        while (bitMask_ < words * 64) bitMask_ <<= 1;  // 位数取2的幂，用掩码代替取模
+        words = bitMask_ / 64;
+        --bitMask_;
+        for (auto& filter : filters_) {
+            filter.reset(new std::atomic<uint64_t>[words]);
+            for (size_t i = 0; i < words; ++i) filter[i].store(0, std::memory_order_relaxed);
+        }
+        words_ = words;
+    }
+
+    // 记录一次出现 | 窗口内（当前或上一个过滤器中）已经出现过则返回true，表示允许进入缓存
+    bool admit(uint64_t hash) {
+        int current = current_.load(std::memory_order_acquire);
+        if (contains(filters_[current].get(), hash)) return true;
+        if (contains(filters_[current ^ 1].get(), hash)) {
+            insert(filters_[current].get(), hash);  // 仍然活跃的 key 延续到当前窗口
+            return true;
+        }
+
+        insert(filters_[current].get(), hash);
+        if (inserted_.fetch_add(1, std::memory_order_relaxed) + 1 == window_) rotate(current);
+        return false;
+    }
+
+private:
+    // 双重哈希生成 hashCount_ 个位置。调用方传入的往往是 std::hash，对整数是恒等映射，
+    // 先用 murmur3 的 finalizer 打散，否则 h2 恒为 1，几个位置落在相邻的位上
+    template <typename Fn>
+    void forEachBit(uint64_t hash, Fn fn) const {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+        uint64_t h1 = hash;
+        uint64_t h2 = (hash >> 32) | (hash << 32) | 1;
+        for (int i = 0; i < hashCount_; ++i) fn((h1 + i * h2) & bitMask_);
+    }
+
+    bool contains(const std::atomic<uint64_t>* filter, uint64_t hash) const {
+        bool all = true;
+        forEachBit(hash, [&](uint64_t bit) {
+            if (all && !(filter[bit / 64].load(std::memory_order_relaxed) & (1ull << (bit % 64)))) all = false;
+        });
+        return all;
+    }
+
+    void insert(std::atomic<uint64_t>* filter, uint64_t hash) {
+        forEachBit(hash, [&](uint64_t bit) {
+            uint64_t mask = 1ull << (bit % 64);
+            // 已置位时跳过写操作，避免热点 key 反复使缓存行失效
+            if (!(filter[bit / 64].load(std::memory_order_relaxed) & mask)) {
+                filter[bit / 64].fetch_or(mask, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // 恰好写满窗口的线程负责轮换；轮换期间的并发检查最多产生少量误判，不影响正确性
+    void rotate(int current) {
+        std::atomic<uint64_t>* older = filters_[current ^ 1].get();
+        for (size_t i = 0; i < words_; ++i) older[i].store(0, std::memory_order_relaxed);
+        current_.store(current ^ 1, std::memory_order_release);
+        inserted_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    size_t window_;
+    int hashCount_;
+    size_t words_ = 0;
+    uint64_t bitMask_ = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> filters_[2];
+    std::atomic<int> current_{0};
+    std::atomic<size_t> inserted_{0};
+};
+
+}  // namespace KamaCache
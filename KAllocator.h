@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace KamaCache {
+
+// 缓存引擎的 Alloc 模板参数可以是任意元素类型的分配器，引擎内部按需要的类型 rebind：
+// 结点通过 std::allocate_shared 分配（控制块与结点一次分配），哈希表、频次链表等容器使用 rebind 后的分配器。
+// 默认使用 std::allocator，行为与不带分配器时相同；使用 std::pmr::polymorphic_allocator 时可以让每个分片
+// 使用各自的 memory_resource（例如 unsynchronized_pool_resource 加上 KCountingResource 统计内存）
+using KDefaultAlloc = std::allocator<char>;
+using KPmrAlloc = std::pmr::polymorphic_allocator<std::byte>;
+
+template <typename Alloc, typename T>
+using KReboundAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+template <typename Key, typename Mapped, typename Alloc, typename Hash = std::hash<Key>>
+using KUnorderedMap = std::unordered_map<Key, Mapped, Hash, std::equal_to<Key>,
+                                         KReboundAlloc<Alloc, std::pair<const Key, Mapped>>>;
+
+template <typename Key, typename Mapped, typename Alloc>
+using KUnorderedMultimap = std::unordered_multimap<Key, Mapped, std::hash<Key>, std::equal_to<Key>,
+                                                   KReboundAlloc<Alloc, std::pair<const Key, Mapped>>>;
+
+// 统计经过它分配的内存：转发给上游资源，记录当前占用字节数、峰值与分配次数。计数是原子的，
+// 但是否线程安全取决于上游资源（unsynchronized_pool_resource 只能在一个分片的锁内使用）
+class KCountingResource : public std::pmr::memory_resource {
+public:
+    explicit KCountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream) {}
+
+    size_t bytesInUse() const { return bytesInUse_.load(std::memory_order_relaxed); }
+    size_t peakBytes() const { return peakBytes_.load(std::memory_order_relaxed); }
+    size_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = upstream_->allocate(bytes, alignment);
+        size_t inUse = bytesInUse_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peakBytes_.load(std::memory_order_relaxed);
+        while (inUse > peak && !peakBytes_.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) {
+        }
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(p, bytes, alignment);
+        bytesInUse_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> bytesInUse_{0};
+    std::atomic<size_t> peakBytes_{0};
+    std::atomic<size_t> allocations_{0};
+};
+
+}  // namespace KamaCache
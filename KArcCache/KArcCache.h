@@ -8,14 +8,15 @@
 
 namespace KamaCache {
 
-template <typename Key, typename Value>
+// Alloc 用于两部分的结点、哈希表、频次链表以及幽灵缓存的内存分配，见 KAllocator.h；Mutex 为两部分各自的锁类型，见 KLock.h
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class KArcCache : public KICachePolicy<Key, Value> {
 public:
-    explicit KArcCache(size_t capacity = 10, size_t transformThreshold = 2)
+    explicit KArcCache(size_t capacity = 10, size_t transformThreshold = 2, const Alloc& alloc = Alloc())
         : capacity_(capacity),
           transformThreshold_(transformThreshold),
-          lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold)),
-          lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold)) {}
+          lruPart_(std::make_unique<ArcLruPart<Key, Value, Alloc, Mutex>>(capacity, transformThreshold, alloc)),
+          lfuPart_(std::make_unique<ArcLfuPart<Key, Value, Alloc, Mutex>>(capacity, transformThreshold, alloc)) {}
 
     ~KArcCache() override = default;
 
@@ -70,8 +71,8 @@ private:
 private:
     size_t capacity_;
     size_t transformThreshold_;
-    std::unique_ptr<ArcLruPart<Key, Value>> lruPart_;
-    std::unique_ptr<ArcLfuPart<Key, Value>> lfuPart_;
+    std::unique_ptr<ArcLruPart<Key, Value, Alloc, Mutex>> lruPart_;
+    std::unique_ptr<ArcLfuPart<Key, Value, Alloc, Mutex>> lfuPart_;
 };
 
 }  // namespace KamaCache
\ No newline at end of file
@@ -30,9 +30,9 @@ public:
 
     void incrementAccessCount() { ++accessCount_; }
 
-    template <typename K, typename V>
+    template <typename K, typename V, typename A, typename M>
     friend class ArcLruPart;
-    template <typename K, typename V>
+    template <typename K, typename V, typename A, typename M>
     friend class ArcLfuPart;
 };
 
@@ -5,27 +5,49 @@
 #include <mutex>
 #include <unordered_map>
 
+#include "../KAllocator.h"
+#include "../KLock.h"
 #include "KArcCacheNode.h"
 
 namespace KamaCache {
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class ArcLfuPart {
 public:
     using NodeType = ArcNode<Key, Value>;
     using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
-    using FreqMap = std::map<size_t, std::list<NodePtr>>;
-
-    explicit ArcLfuPart(size_t capacity, size_t transformThreshold)
-        : capacity_(capacity), ghostCapacity_(capacity), transformThreshold_(transformThreshold), minFreq_(0) {
+    using NodeMap = KUnorderedMap<Key, NodePtr, Alloc>;
+    using FreqList = std::list<NodePtr, KReboundAlloc<Alloc, NodePtr>>;
+    using FreqMap = std::map<size_t, FreqList, std::less<size_t>, KReboundAlloc<Alloc, std::pair<const size_t, FreqList>>>;
+
+    explicit ArcLfuPart(size_t capacity, size_t transformThreshold, const Alloc& alloc = Alloc())
+        : capacity_(capacity),
+          ghostCapacity_(capacity),
+          transformThreshold_(transformThreshold),
+          minFreq_(0),
+          mainCache_(typename NodeMap::allocator_type(alloc)),
+          ghostCache_(typename NodeMap::allocator_type(alloc)),
+          freqMap_(typename FreqMap::allocator_type(alloc)),
+          alloc_(alloc) {
         initializeLists();
     }
 
+    // 结点之间用 shared_ptr 双向相连，析构时断开链表避免循环引用
+    ~ArcLfuPart() {
+        for (NodePtr node : {ghostHead_}) {
+            while (node) {
+                NodePtr next = node->next_;
+                node->prev_ = nullptr;
+                node->next_ = nullptr;
+                node = next;
+            }
+        }
+    }
+
     bool put(Key key, Value value) {
         if (capacity_ == 0) return false;
 
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = mainCache_.find(key);
         if (it != mainCache_.end()) {
             return updateExistingNode(it->second, value);
@@ -34,7 +56,7 @@ public:
     }
 
     bool get(Key key, Value& value) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = mainCache_.find(key);
         if (it != mainCache_.end()) {
             updateNodeFrequency(it->second);
@@ -67,8 +89,8 @@ public:
 
 private:
     void initializeLists() {
-        ghostHead_ = std::make_shared<NodeType>();
-        ghostTail_ = std::make_shared<NodeType>();
+        ghostHead_ = std::allocate_shared<NodeType>(alloc_);
+        ghostTail_ = std::allocate_shared<NodeType>(alloc_);
         ghostHead_->next_ = ghostTail_;
         ghostTail_->prev_ = ghostHead_;
     }
@@ -84,14 +106,11 @@ private:
             evictLeastFrequent();
         }
 
-        NodePtr newNode = std::make_shared<NodeType>(key, value);
+        NodePtr newNode = std::allocate_shared<NodeType>(alloc_, key, value);
         mainCache_[key] = newNode;
 
-        // 将新节点添加到频率为1的列表中
-        if (freqMap_.find(1) == freqMap_.end()) {
-            freqMap_[1] = std::list<NodePtr>();
-        }
-        freqMap_[1].push_back(newNode);
+        // 将新节点添加到频率为1的列表中（不存在时创建，链表使用与 freqMap_ 相同的分配器）
+        frequencyList(1).push_back(newNode);
         minFreq_ = 1;
 
         return true;
@@ -113,10 +132,15 @@ private:
         }
 
         // 添加到新频率列表
-        if (freqMap_.find(newFreq) == freqMap_.end()) {
-            freqMap_[newFreq] = std::list<NodePtr>();
+        frequencyList(newFreq).push_back(node);
+    }
+
+    FreqList& frequencyList(size_t freq) {
+        auto it = freqMap_.find(freq);
+        if (it == freqMap_.end()) {
+            it = freqMap_.emplace(freq, FreqList(typename FreqList::allocator_type(alloc_))).first;
         }
-        freqMap_[newFreq].push_back(node);
+        return it->second;
     }
 
     void evictLeastFrequent() {
@@ -175,7 +199,7 @@ private:
     size_t ghostCapacity_;
     size_t transformThreshold_;
     size_t minFreq_;
-    std::mutex mutex_;
+    Mutex mutex_;
 
     NodeMap mainCache_;
     NodeMap ghostCache_;
@@ -183,6 +207,7 @@ private:
 
     NodePtr ghostHead_;
     NodePtr ghostTail_;
+    Alloc alloc_;  // 结点与频次链表的分配器
 };
 
 }  // namespace KamaCache
\ No newline at end of file
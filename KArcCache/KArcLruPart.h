@@ -3,26 +3,45 @@
 #include <mutex>
 #include <unordered_map>
 
+#include "../KAllocator.h"
+#include "../KLock.h"
 #include "KArcCacheNode.h"
 
 namespace KamaCache {
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class ArcLruPart {
 public:
     using NodeType = ArcNode<Key, Value>;
     using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
-
-    explicit ArcLruPart(size_t capacity, size_t transformThreshold)
-        : capacity_(capacity), ghostCapacity_(capacity), transformThreshold_(transformThreshold) {
+    using NodeMap = KUnorderedMap<Key, NodePtr, Alloc>;
+
+    explicit ArcLruPart(size_t capacity, size_t transformThreshold, const Alloc& alloc = Alloc())
+        : capacity_(capacity),
+          ghostCapacity_(capacity),
+          transformThreshold_(transformThreshold),
+          mainCache_(typename NodeMap::allocator_type(alloc)),
+          ghostCache_(typename NodeMap::allocator_type(alloc)),
+          alloc_(alloc) {
         initializeLists();
     }
 
+    // 结点之间用 shared_ptr 双向相连，析构时断开链表避免循环引用
+    ~ArcLruPart() {
+        for (NodePtr node : {mainHead_, ghostHead_}) {
+            while (node) {
+                NodePtr next = node->next_;
+                node->prev_ = nullptr;
+                node->next_ = nullptr;
+                node = next;
+            }
+        }
+    }
+
     bool put(Key key, Value value) {
         if (capacity_ == 0) return false;
 
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = mainCache_.find(key);
         if (it != mainCache_.end()) {
             return updateExistingNode(it->second, value);
@@ -31,7 +50,7 @@ public:
     }
 
     bool get(Key key, Value& value, bool& shouldTransform) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = mainCache_.find(key);
         if (it != mainCache_.end()) {
             shouldTransform = updateNodeAccess(it->second);
@@ -64,13 +83,13 @@ public:
 
 private:
     void initializeLists() {
-        mainHead_ = std::make_shared<NodeType>();
-        mainTail_ = std::make_shared<NodeType>();
+        mainHead_ = std::allocate_shared<NodeType>(alloc_);
+        mainTail_ = std::allocate_shared<NodeType>(alloc_);
         mainHead_->next_ = mainTail_;
         mainTail_->prev_ = mainHead_;
 
-        ghostHead_ = std::make_shared<NodeType>();
-        ghostTail_ = std::make_shared<NodeType>();
+        ghostHead_ = std::allocate_shared<NodeType>(alloc_);
+        ghostTail_ = std::allocate_shared<NodeType>(alloc_);
         ghostHead_->next_ = ghostTail_;
         ghostTail_->prev_ = ghostHead_;
     }
@@ -86,7 +105,7 @@ private:
             evictLeastRecent();  // 驱逐最近最少访问
         }
 
-        NodePtr newNode = std::make_shared<NodeType>(key, value);
+        NodePtr newNode = std::allocate_shared<NodeType>(alloc_, key, value);
         mainCache_[key] = newNode;
         addToFront(newNode);
         return true;
@@ -167,7 +186,7 @@ private:
     size_t capacity_;
     size_t ghostCapacity_;
     size_t transformThreshold_;  // 转换门槛值
-    std::mutex mutex_;
+    Mutex mutex_;
 
     NodeMap mainCache_;  // key -> ArcNode
     NodeMap ghostCache_;
@@ -178,6 +197,7 @@ private:
     // 淘汰链表
     NodePtr ghostHead_;
     NodePtr ghostTail_;
+    Alloc alloc_;  // 结点分配器
 };
 
 }  // namespace KamaCache
\ No newline at end of file
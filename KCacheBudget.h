@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "KSeededHash.h"
+
+namespace KamaCache {
+
+// 字符串、vector 在对象之外占用的堆内存，其他类型视为 0。短字符串存放在对象内部（SSO），不计入
+template <typename T>
+size_t heapBytes(const T& value) {
+    if constexpr (detail::IsStringLike<T>::value) {
+        using Char = typename T::value_type;
+        if constexpr (std::is_same_v<T, std::basic_string<Char, typename T::traits_type, typename T::allocator_type>>) {
+            return value.capacity() > 15 / sizeof(Char) ? (value.capacity() + 1) * sizeof(Char) : 0;
+        } else {
+            return 0;  // string_view 不拥有内存
+        }
+    } else {
+        return 0;
+    }
+}
+
+template <typename T, typename A>
+size_t heapBytes(const std::vector<T, A>& value) {
+    return value.capacity() * sizeof(T);
+}
+
+// 一个账户（或同名的一组账户，例如分片缓存的所有分片）的统计信息
+struct KBudgetStats {
+    std::string name;
+    size_t bytes = 0;        // 当前计费的字节数
+    size_t ghostBytes = 0;   // 影子表覆盖的字节数：最近被淘汰、若缓存再大这么多就还在的元素
+    size_t ghostHits = 0;    // 未命中的 key 出现在影子表中的次数
+    size_t misses = 0;       // 未命中次数
+    size_t evictedBytes = 0; // 因超出预算被预算淘汰的字节数
+    double utility = 0;      // 最近一段时间每个影子字节的命中数（衰减平均），即再给这个缓存一个字节的边际收益
+};
+
+// 多个缓存共享的全局内存预算。各个缓存（KLruCache、KLfuCache 及其分片版本）通过 setMemoryBudget 加入，
+// 每次写入按元素的字节数计费；总字节数超过上限时，预算从边际效用最低的缓存中按其自身的淘汰顺序移除元素，
+// 直到回到上限以下。每个缓存的容量只作为上限，实际占用多少内存由预算在缓存之间调配，
+// 空闲的缓存不再占着内存而繁忙的缓存在抖动。
+// 边际效用由影子表估计：每个缓存记录最近被淘汰的元素（只保存 key 的哈希与字节数，总共覆盖 ghostBytes 字节），
+// 之后未命中的 key 出现在影子表中，说明缓存再大 ghostBytes 字节就会命中。影子命中数按回收的轮次做衰减平均，
+// 除以影子表覆盖的字节数即命中率曲线（MRC）在当前大小处的斜率。
+// 预算只在超出上限时回收，是软上限：并发写入可能短暂地超出，超出的部分在下一次写入时回收。
+// 需要用 std::make_shared 创建，并且要比加入的缓存活得更久或先让缓存退出
+class KCacheBudget : public std::enable_shared_from_this<KCacheBudget> {
+public:
+    // 一个缓存在预算中的账户。计费与影子表只在所属缓存的锁内调用，预算只读取其中的原子计数
+    class Account {
+    public:
+        ~Account() { budget_->leave(this); }
+
+        Account(const Account&) = delete;
+        Account& operator=(const Account&) = delete;
+
+        void charge(size_t bytes) {
+            bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            budget_->used_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        void release(size_t bytes) {
+            bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+            budget_->used_.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        // 元素因容量或预算被淘汰，记入影子表
+        void recordEviction(uint64_t hash, size_t bytes) {
+            ghost_.emplace_back(hash, bytes);
+            ++ghostIndex_[hash];
+            size_t ghostBytes = ghostBytes_.load(std::memory_order_relaxed) + bytes;
+            while (ghostBytes > budget_->ghostBytes_ && !ghost_.empty()) {
+                auto oldest = ghost_.front();
+                ghost_.pop_front();
+                auto it = ghostIndex_.find(oldest.first);
+                if (--it->second == 0) ghostIndex_.erase(it);
+                ghostBytes -= oldest.second;
+            }
+            ghostBytes_.store(ghostBytes, std::memory_order_relaxed);
+        }
+
+        // 未命中时查询影子表
+        void recordMiss(uint64_t hash) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            if (ghostIndex_.count(hash)) ghostHits_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        size_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+        const std::shared_ptr<KCacheBudget>& budget() const { return budget_; }
+
+    private:
+        friend class KCacheBudget;
+
+        Account(std::shared_ptr<KCacheBudget> budget, std::string name, std::function<size_t(size_t)> evict)
+            : budget_(std::move(budget)), name_(std::move(name)), evict_(std::move(evict)) {}
+
+        std::shared_ptr<KCacheBudget> budget_;
+        std::string name_;
+        std::function<size_t(size_t)> evict_;  // 按淘汰顺序移除至少这么多字节 | 返回实际移除的字节数
+        std::atomic<size_t> bytes_{0};
+        std::atomic<size_t> ghostBytes_{0};
+        std::atomic<size_t> ghostHits_{0};
+        std::atomic<size_t> misses_{0};
+        std::atomic<size_t> evictedBytes_{0};
+        std::deque<std::pair<uint64_t, size_t>> ghost_;   // 最近被淘汰的元素（key 哈希，字节数），从旧到新
+        std::unordered_map<uint64_t, uint32_t> ghostIndex_;  // key 哈希 -> 在影子表中出现的次数
+        // 以下由预算在 mutex_ 内维护
+        double score_ = 0;         // 影子命中数的衰减平均
+        size_t seenGhostHits_ = 0; // 上一轮回收时读到的 ghostHits_
+    };
+
+    // limitBytes 为所有缓存合计的字节上限；ghostBytes 为每个缓存影子表覆盖的字节数，为 0 时取上限的 1/8
+    explicit KCacheBudget(size_t limitBytes, size_t ghostBytes = 0)
+        : limit_(limitBytes), ghostBytes_(ghostBytes > 0 ? ghostBytes : std::max<size_t>(limitBytes / 8, 1)) {}
+
+    KCacheBudget(const KCacheBudget&) = delete;
+    KCacheBudget& operator=(const KCacheBudget&) = delete;
+
+    // 加入预算，evict(bytes) 需要按缓存自己的淘汰顺序移除至少 bytes 字节（不足时全部移除）并返回移除的字节数，
+    // 它在预算的锁内调用，可以加缓存自己的锁。账户析构时退出预算，之后不会再调用 evict
+    std::unique_ptr<Account> join(std::string name, std::function<size_t(size_t)> evict) {
+        std::unique_ptr<Account> account(new Account(shared_from_this(), std::move(name), std::move(evict)));
+        std::lock_guard<std::mutex> lock(mutex_);
+        accounts_.push_back(account.get());
+        return account;
+    }
+
+    // 总字节数超过上限时回收：每一轮把所有账户的影子命中计入衰减平均，从效用最低的缓存中移除超出的部分
+    // （外加上限的 1/64，避免每次写入都触发回收），直到回到上限以下。已有线程在回收时直接返回 | 返回移除的字节数
+    size_t rebalance() {
+        if (!overLimit()) return 0;
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock) return 0;
+
+        for (Account* account : accounts_) {
+            size_t hits = account->ghostHits_.load(std::memory_order_relaxed);
+            account->score_ = account->score_ * kDecay + static_cast<double>(hits - account->seenGhostHits_);
+            account->seenGhostHits_ = hits;
+        }
+
+        size_t freed = 0;
+        std::vector<Account*> candidates(accounts_);
+        while (!candidates.empty()) {
+            size_t limit = limit_.load(std::memory_order_relaxed);
+            size_t used = used_.load(std::memory_order_relaxed);
+            if (used <= limit) break;
+            auto victim = std::min_element(candidates.begin(), candidates.end(), [](Account* a, Account* b) {
+                double ua = utility(*a), ub = utility(*b);
+                return ua != ub ? ua < ub : a->bytes() > b->bytes();
+            });
+            Account* account = *victim;
+            size_t excess = used - limit + limit / 64;
+            size_t evicted = account->bytes() > 0 ? account->evict_(excess) : 0;
+            account->evictedBytes_.fetch_add(evicted, std::memory_order_relaxed);
+            freed += evicted;
+            if (evicted < excess) candidates.erase(victim);  // 已经淘汰空了，换下一个缓存
+        }
+        return freed;
+    }
+
+    bool overLimit() const { return used_.load(std::memory_order_relaxed) > limit_.load(std::memory_order_relaxed); }
+
+    // 调整上限，变小时立即回收
+    void setLimit(size_t limitBytes) {
+        limit_.store(limitBytes, std::memory_order_relaxed);
+        rebalance();
+    }
+
+    size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+    // 各缓存的统计信息，同名的账户（同一个分片缓存的各个分片）合并为一项，按名字排序
+    std::vector<KBudgetStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, KBudgetStats> merged;
+        for (Account* account : accounts_) {
+            KBudgetStats& stats = merged[account->name_];
+            stats.name = account->name_;
+            stats.bytes += account->bytes();
+            stats.ghostBytes += account->ghostBytes_.load(std::memory_order_relaxed);
+            stats.ghostHits += account->ghostHits_.load(std::memory_order_relaxed);
+            stats.misses += account->misses_.load(std::memory_order_relaxed);
+            stats.evictedBytes += account->evictedBytes_.load(std::memory_order_relaxed);
+            stats.utility += account->score_;
+        }
+        std::vector<KBudgetStats> result;
+        for (auto& entry : merged) {
+            KBudgetStats& stats = entry.second;
+            stats.utility = stats.ghostBytes > 0 ? stats.utility / stats.ghostBytes : 0;
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+private:
+    static constexpr double kDecay = 0.875;  // 每一轮回收时影子命中数衰减平均的保留比例
+
+    // 持有 mutex_ 时调用：每个影子字节的命中数。影子表为空（还没有淘汰过）时为 0，最先被回收
+    static double utility(const Account& account) {
+        size_t ghostBytes = account.ghostBytes_.load(std::memory_order_relaxed);
+        return ghostBytes > 0 ? account.score_ / ghostBytes : 0;
+    }
+
+    void leave(Account* account) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accounts_.erase(std::find(accounts_.begin(), accounts_.end(), account));
+        used_.fetch_sub(account->bytes(), std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> used_{0};  // 所有账户合计的字节数
+    size_t ghostBytes_;            // 每个账户影子表覆盖的字节数
+    mutable std::mutex mutex_;     // 保护 accounts_ 与回收过程
+    std::vector<Account*> accounts_;
+};
+
+// 与 KDeferredRelease 的用法相同：在 lock_guard 之前声明，锁内发现超出预算时记下预算，解锁后再回收。
+// 回收会加其他缓存的锁，不能在持有本缓存的锁时进行
+class KDeferredRebalance {
+public:
+    KDeferredRebalance() = default;
+    KDeferredRebalance(const KDeferredRebalance&) = delete;
+    KDeferredRebalance& operator=(const KDeferredRebalance&) = delete;
+
+    ~KDeferredRebalance() {
+        if (budget_) budget_->rebalance();
+    }
+
+    void request(const std::shared_ptr<KCacheBudget>& budget) { budget_ = budget; }
+
+private:
+    std::shared_ptr<KCacheBudget> budget_;
+};
+
+// 缓存内部的计费器：未加入预算时所有操作都只是一次空指针判断。除 setAccount 外都在缓存的锁内调用
+template <typename Key, typename Value>
+class KBudgetMeter {
+public:
+    using Account = KCacheBudget::Account;
+    using EntryBytes = std::function<size_t(const Key&, const Value&)>;
+
+    // nodeBytes 为缓存中每个元素固定的开销（结点、哈希表结点等），默认的元素字节数在此之上加上 key、value 的堆内存
+    explicit KBudgetMeter(size_t nodeBytes) : nodeBytes_(nodeBytes) {}
+
+    bool enabled() const { return account_ != nullptr; }
+
+    size_t bytesOf(const Key& key, const Value& value) const {
+        return entryBytes_ ? entryBytes_(key, value) : nodeBytes_ + heapBytes(key) + heapBytes(value);
+    }
+
+    void inserted(const Key& key, const Value& value) {
+        if (account_) account_->charge(bytesOf(key, value));
+    }
+
+    void erased(const Key& key, const Value& value) {
+        if (account_) account_->release(bytesOf(key, value));
+    }
+
+    // 淘汰时调用，元素同时进入影子表 | 返回释放的字节数，未加入预算时为 0
+    size_t evicted(const Key& key, const Value& value) {
+        if (!account_) return 0;
+        size_t bytes = bytesOf(key, value);
+        account_->release(bytes);
+        account_->recordEviction(std::hash<Key>{}(key), bytes);
+        return bytes;
+    }
+
+    void missed(const Key& key) {
+        if (account_) account_->recordMiss(std::hash<Key>{}(key));
+    }
+
+    // 写入之后调用：超出预算时让 pending 在解锁后回收
+    void check(KDeferredRebalance& pending) {
+        if (account_ && account_->budget()->overLimit()) pending.request(account_->budget());
+    }
+
+    // 换成新的账户，返回旧账户。旧账户的析构需要预算的锁，要在解锁后进行
+    std::unique_ptr<Account> setAccount(std::unique_ptr<Account> account, EntryBytes entryBytes) {
+        std::swap(account_, account);
+        entryBytes_ = std::move(entryBytes);
+        return account;
+    }
+
+private:
+    size_t nodeBytes_;
+    EntryBytes entryBytes_;  // 为空时按 nodeBytes_ 加堆内存估算
+    std::unique_ptr<Account> account_;
+};
+
+}  // namespace KamaCache
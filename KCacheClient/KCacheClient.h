@@ -0,0 +1,330 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../KCacheServer/KBinaryProtocol.h"
+#include "KConsistentHash.h"
+
+namespace KamaCache {
+
+// 缓存节点地址：unixPath 非空时通过 unix socket 连接，否则连接 host:port
+struct KCacheNodeAddress {
+    std::string name;  // 节点在哈希环上的名字，需在集群内唯一
+    std::string host = "127.0.0.1";
+    int port = 11211;
+    std::string unixPath;
+};
+
+// 与一个缓存节点之间的阻塞连接（二进制协议），带接收缓冲
+class KCacheConnection {
+public:
+    using Header = KBinaryProtocol::Header;
+
+    ~KCacheConnection() { ::close(fd_); }
+
+    // 建立连接，失败返回空指针
+    static std::unique_ptr<KCacheConnection> connect(const KCacheNodeAddress& address, int timeoutMs) {
+        int fd = -1;
+        if (!address.unixPath.empty()) {
+            fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        } else {
+            fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        }
+        if (fd < 0) return nullptr;
+
+        // 发送超时同时作用于 connect
+        timeval tv{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        int rc = -1;
+        if (!address.unixPath.empty()) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, address.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+            rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        } else {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(address.port));
+            if (::inet_pton(AF_INET, address.host.c_str(), &addr.sin_addr) == 1) {
+                rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        if (rc < 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        return std::unique_ptr<KCacheConnection>(new KCacheConnection(fd));
+    }
+
+    int fd() const { return fd_; }
+
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    // 从 socket 读一次数据到接收缓冲。nonBlocking 为 true 时不等待 | 连接出错或超时返回false
+    bool receive(bool nonBlocking) {
+        char chunk[16 * 1024];
+        while (true) {
+            ssize_t n = ::recv(fd_, chunk, sizeof(chunk), nonBlocking ? MSG_DONTWAIT : 0);
+            if (n > 0) {
+                buffer_.append(chunk, n);
+                return true;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            return nonBlocking && n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+
+    // 从接收缓冲中取出一条完整的响应 | 数据不足返回false
+    bool popResponse(Header& header, std::string& value) {
+        if (buffer_.size() - offset_ < KBinaryProtocol::kHeaderSize) return false;
+        Header h = KBinaryProtocol::decodeHeader(buffer_.data() + offset_);
+        if (buffer_.size() - offset_ < KBinaryProtocol::kHeaderSize + h.valueLength) return false;
+        header = h;
+        value.assign(buffer_, offset_ + KBinaryProtocol::kHeaderSize, h.valueLength);
+        offset_ += KBinaryProtocol::kHeaderSize + h.valueLength;
+        if (offset_ == buffer_.size()) {
+            buffer_.clear();
+            offset_ = 0;
+        }
+        return true;
+    }
+
+    // 阻塞读取一条响应 | 连接出错、超时或响应格式错误返回false
+    bool readResponse(Header& header, std::string& value) {
+        while (!popResponse(header, value)) {
+            if (!receive(false)) return false;
+        }
+        return header.magic == KBinaryProtocol::kResponseMagic;
+    }
+
+private:
+    explicit KCacheConnection(int fd) : fd_(fd) {}
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t offset_ = 0;
+};
+
+// 单个节点的连接池：按需建立连接，归还时最多保留 maxIdle 条空闲连接
+class KConnectionPool {
+public:
+    KConnectionPool(KCacheNodeAddress address, size_t maxIdle, int timeoutMs)
+        : address_(std::move(address)), maxIdle_(maxIdle), timeoutMs_(timeoutMs) {}
+
+    const KCacheNodeAddress& address() const { return address_; }
+
+    // 取出一条空闲连接或新建连接，失败返回空指针
+    std::unique_ptr<KCacheConnection> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                std::unique_ptr<KCacheConnection> conn = std::move(idle_.back());
+                idle_.pop_back();
+                return conn;
+            }
+        }
+        return KCacheConnection::connect(address_, timeoutMs_);
+    }
+
+    // 归还一条状态正常的连接（出错的连接直接丢弃即可）
+    void release(std::unique_ptr<KCacheConnection> conn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < maxIdle_) idle_.push_back(std::move(conn));
+    }
+
+private:
+    KCacheNodeAddress address_;
+    size_t maxIdle_;
+    int timeoutMs_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<KCacheConnection>> idle_;
+};
+
+// 多节点缓存客户端：通过一致性哈希环把 key 分配到节点，每个节点一个连接池。
+// 网络错误按未命中处理（缓存语义下调用方回源即可），出错的连接会被丢弃
+class KCacheClient {
+public:
+    explicit KCacheClient(size_t maxIdlePerNode = 8, int timeoutMs = 1000, int pointsPerNode = 160)
+        : maxIdlePerNode_(maxIdlePerNode), timeoutMs_(timeoutMs), ring_(pointsPerNode) {}
+
+    // 添加节点，只有约 1/N 的 key 会重新映射到新节点 | 同名节点已存在返回false
+    bool addNode(const KCacheNodeAddress& address) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!ring_.addNode(address.name)) return false;
+        pools_[address.name] = std::make_shared<KConnectionPool>(address, maxIdlePerNode_, timeoutMs_);
+        return true;
+    }
+
+    // 移除节点，其上的 key 分散到环上的相邻节点。正在使用该节点连接的请求不受影响
+    bool removeNode(const std::string& name) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!ring_.removeNode(name)) return false;
+        pools_.erase(name);
+        return true;
+    }
+
+    // key 当前所属节点的名字，没有节点时返回空串
+    std::string nodeFor(const std::string& key) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const std::string* node = ring_.nodeFor(key);
+        return node ? *node : std::string();
+    }
+
+    bool set(const std::string& key, const std::string& value, uint32_t flags = 0) {
+        std::string request;
+        KBinaryProtocol::appendRequest(request, KBinaryProtocol::kSet, key, value, flags);
+        KBinaryProtocol::Header header;
+        std::string response;
+        return roundTrip(key, request, header, response) && header.keyLengthOrStatus == KBinaryProtocol::kOk;
+    }
+
+    bool get(const std::string& key, std::string& value) {
+        std::string request;
+        KBinaryProtocol::appendRequest(request, KBinaryProtocol::kGet, key);
+        KBinaryProtocol::Header header;
+        return roundTrip(key, request, header, value) && header.keyLengthOrStatus == KBinaryProtocol::kOk;
+    }
+
+    bool remove(const std::string& key) {
+        std::string request;
+        KBinaryProtocol::appendRequest(request, KBinaryProtocol::kDelete, key);
+        KBinaryProtocol::Header header;
+        std::string response;
+        return roundTrip(key, request, header, response) && header.keyLengthOrStatus == KBinaryProtocol::kOk;
+    }
+
+    // 批量查询：按节点分组，先把各组请求分别以流水线方式发往各节点，再用 poll 同时等待所有节点的响应，
+    // 总耗时约等于最慢节点的一次往返。命中的 key 写入 values[i] 并置 found[i] | 返回命中数
+    size_t multiGet(const std::vector<std::string>& keys, std::vector<std::string>& values, std::vector<bool>& found) {
+        values.assign(keys.size(), std::string());
+        found.assign(keys.size(), false);
+
+        // 1. 按节点分组
+        std::unordered_map<std::shared_ptr<KConnectionPool>, std::vector<uint32_t>> groups;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            for (size_t i = 0; i < keys.size(); ++i) {
+                const std::string* node = ring_.nodeFor(keys[i]);
+                if (node) groups[pools_.at(*node)].push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        // 2. 向每个节点发送该组的全部请求，opaque 携带 key 的下标
+        struct Pending {
+            std::shared_ptr<KConnectionPool> pool;
+            std::unique_ptr<KCacheConnection> conn;
+            size_t remaining;
+        };
+        std::vector<Pending> pendings;
+        std::string request;
+        for (auto& group : groups) {
+            std::unique_ptr<KCacheConnection> conn = group.first->acquire();
+            if (!conn) continue;
+            request.clear();
+            for (uint32_t index : group.second) {
+                KBinaryProtocol::appendRequest(request, KBinaryProtocol::kGet, keys[index], {}, 0, index);
+            }
+            if (!conn->sendAll(request)) continue;
+            pendings.push_back({group.first, std::move(conn), group.second.size()});
+        }
+
+        // 3. 同时等待所有节点的响应
+        size_t hits = 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs_);
+        std::vector<pollfd> fds;
+        KBinaryProtocol::Header header;
+        std::string value;
+        while (true) {
+            fds.clear();
+            for (auto& pending : pendings) {
+                if (pending.conn && pending.remaining > 0) fds.push_back({pending.conn->fd(), POLLIN, 0});
+            }
+            if (fds.empty()) break;
+
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0 || ::poll(fds.data(), fds.size(), static_cast<int>(left.count())) <= 0) break;
+
+            for (auto& pending : pendings) {
+                if (!pending.conn || pending.remaining == 0) continue;
+                if (!pending.conn->receive(true)) {
+                    pending.conn.reset();  // 连接出错，该组剩余的 key 按未命中处理
+                    continue;
+                }
+                while (pending.remaining > 0 && pending.conn->popResponse(header, value)) {
+                    --pending.remaining;
+                    if (header.opaque >= keys.size()) continue;
+                    if (header.keyLengthOrStatus == KBinaryProtocol::kOk) {
+                        values[header.opaque] = std::move(value);
+                        found[header.opaque] = true;
+                        ++hits;
+                    }
+                }
+            }
+        }
+
+        // 只有完整收到所有响应的连接才能归还，否则连接上还残留着未读的数据
+        for (auto& pending : pendings) {
+            if (pending.conn && pending.remaining == 0) pending.pool->release(std::move(pending.conn));
+        }
+        return hits;
+    }
+
+private:
+    std::shared_ptr<KConnectionPool> poolFor(const std::string& key) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const std::string* node = ring_.nodeFor(key);
+        return node ? pools_.at(*node) : nullptr;
+    }
+
+    // 发送一个请求并等待响应
+    bool roundTrip(const std::string& key,
+                   const std::string& request,
+                   KBinaryProtocol::Header& header,
+                   std::string& value) {
+        std::shared_ptr<KConnectionPool> pool = poolFor(key);
+        if (!pool) return false;
+        std::unique_ptr<KCacheConnection> conn = pool->acquire();
+        if (!conn || !conn->sendAll(request) || !conn->readResponse(header, value)) return false;
+        pool->release(std::move(conn));
+        return true;
+    }
+
+private:
+    size_t maxIdlePerNode_;
+    int timeoutMs_;
+    mutable std::shared_mutex mutex_;  // 保护哈希环与连接池表
+    KConsistentHash ring_;
+    std::unordered_map<std::string, std::shared_ptr<KConnectionPool>> pools_;
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace KamaCache {
+
+// 跨进程、跨语言稳定的 64 位哈希（FNV-1a 加 murmur3 的 finalizer 打散），同一个 key 在所有客户端上映射一致
+inline uint64_t stableHash64(std::string_view data) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// ketama 一致性哈希环：每个节点在环上放置若干虚拟点，key 落在顺时针方向的第一个虚拟点所属的节点。
+// 增删一个节点时只有约 1/N 的 key 改变归属
+class KConsistentHash {
+public:
+    explicit KConsistentHash(int pointsPerNode = 160) : pointsPerNode_(pointsPerNode) {}
+
+    // 添加节点 | 节点已存在返回false
+    bool addNode(const std::string& node) {
+        if (std::find(nodes_.begin(), nodes_.end(), node) != nodes_.end()) return false;
+        nodes_.push_back(node);
+        for (int i = 0; i < pointsPerNode_; ++i) {
+            ring_.emplace_back(stableHash64(node + "#" + std::to_string(i)), node);
+        }
+        std::sort(ring_.begin(), ring_.end());
+        return true;
+    }
+
+    // 移除节点 | 节点不存在返回false
+    bool removeNode(const std::string& node) {
+        auto it = std::find(nodes_.begin(), nodes_.end(), node);
+        if (it == nodes_.end()) return false;
+        nodes_.erase(it);
+        ring_.erase(std::remove_if(ring_.begin(), ring_.end(), [&](const auto& point) { return point.second == node; }),
+                    ring_.end());
+        return true;
+    }
+
+    // key 所属的节点，环为空时返回空指针
+    const std::string* nodeFor(std::string_view key) const {
+        if (ring_.empty()) return nullptr;
+        uint64_t h = stableHash64(key);
+        auto it = std::lower_bound(
+            ring_.begin(), ring_.end(), h, [](const auto& point, uint64_t value) { return point.first < value; });
+        if (it == ring_.end()) it = ring_.begin();
+        return &it->second;
+    }
+
+    const std::vector<std::string>& nodes() const { return nodes_; }
+
+    bool empty() const { return nodes_.empty(); }
+
+private:
+    int pointsPerNode_;                                 // 每个节点的虚拟点数量
+    std::vector<std::string> nodes_;                    // 真实节点
+    std::vector<std::pair<uint64_t, std::string>> ring_;  // 按哈希值排序的虚拟点
+};
+
+}  // namespace KamaCache
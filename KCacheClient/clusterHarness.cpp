@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../KCacheServer/KCacheItem.h"
+#include "../KCacheServer/KCacheServer.h"
+#include "../KLruCache.h"
+#include "KCacheClient.h"
+
+// 在本进程内启动若干个 kcache 服务节点，测量 KCacheClient 在增删节点时的 key 重映射比例和 multiGet 扇出延迟
+namespace {
+
+using NodeCache = KamaCache::KHashLruCaches<std::string, KamaCache::KCacheItemPtr>;
+
+// 一个本地替身节点：独立的缓存 + 监听随机端口的服务
+struct LocalNode {
+    std::string name;
+    NodeCache cache;
+    KamaCache::KCacheServer<NodeCache> server;
+
+    explicit LocalNode(const std::string& name)
+        : name(name), cache(1000000, 4), server(cache, options()) {
+        server.start();
+    }
+
+    KamaCache::KCacheNodeAddress address() const {
+        KamaCache::KCacheNodeAddress addr;
+        addr.name = name;
+        addr.port = server.tcpPort();
+        return addr;
+    }
+
+    static KamaCache::KCacheServerOptions options() {
+        KamaCache::KCacheServerOptions opts;
+        opts.host = "127.0.0.1";
+        opts.tcpPort = 0;
+        opts.threads = 1;
+        return opts;
+    }
+};
+
+std::string makeKey(int k) { return "key:" + std::to_string(k); }
+
+// 统计有多少 key 的归属节点发生了变化
+double remapFraction(const std::vector<std::string>& before, const std::vector<std::string>& after) {
+    size_t moved = 0;
+    for (size_t i = 0; i < before.size(); ++i) {
+        if (before[i] != after[i]) ++moved;
+    }
+    return static_cast<double>(moved) / before.size();
+}
+
+std::vector<std::string> owners(const KamaCache::KCacheClient& client, int keyCount) {
+    std::vector<std::string> result(keyCount);
+    for (int k = 0; k < keyCount; ++k) result[k] = client.nodeFor(makeKey(k));
+    return result;
+}
+
+void testRemap(std::vector<std::unique_ptr<LocalNode>>& nodes) {
+    std::cout << "\n=== 增删节点的 key 重映射比例 ===" << std::endl;
+    const int KEYS = 20000;
+    const int BASE_NODES = static_cast<int>(nodes.size()) - 1;
+
+    KamaCache::KCacheClient client;
+    for (int i = 0; i < BASE_NODES; ++i) client.addNode(nodes[i]->address());
+
+    // 写入全部 key，之后通过实际命中率验证重映射比例
+    for (int k = 0; k < KEYS; ++k) client.set(makeKey(k), "v" + std::to_string(k));
+    std::vector<std::string> before = owners(client, KEYS);
+
+    auto hitRatio = [&] {
+        std::vector<std::string> keys, values;
+        std::vector<bool> found;
+        for (int k = 0; k < KEYS; ++k) keys.push_back(makeKey(k));
+        return static_cast<double>(client.multiGet(keys, values, found)) / KEYS;
+    };
+
+    client.addNode(nodes[BASE_NODES]->address());
+    std::vector<std::string> added = owners(client, KEYS);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << BASE_NODES << " -> " << BASE_NODES + 1 << " 个节点: 重映射 " << 100 * remapFraction(before, added)
+              << "% (理想值 " << 100.0 / (BASE_NODES + 1) << "%)，仍可命中 " << 100 * hitRatio() << "%" << std::endl;
+
+    client.removeNode(nodes[BASE_NODES]->name);
+    client.removeNode(nodes[0]->name);
+    std::vector<std::string> removed = owners(client, KEYS);
+    std::cout << BASE_NODES << " -> " << BASE_NODES - 1 << " 个节点: 重映射 " << 100 * remapFraction(before, removed)
+              << "% (理想值 " << 100.0 / BASE_NODES << "%)，仍可命中 " << 100 * hitRatio() << "%" << std::endl;
+}
+
+void testFanOut(std::vector<std::unique_ptr<LocalNode>>& nodes) {
+    std::cout << "\n=== multiGet 扇出延迟 ===" << std::endl;
+    const int KEYS = 10000;
+    const int BATCH = 100;
+    const int ROUNDS = 500;
+
+    for (size_t nodeCount = 1; nodeCount <= nodes.size(); nodeCount *= 2) {
+        KamaCache::KCacheClient client;
+        for (size_t i = 0; i < nodeCount; ++i) client.addNode(nodes[i]->address());
+        for (int k = 0; k < KEYS; ++k) client.set(makeKey(k), std::string(100, 'v'));
+
+        std::mt19937 gen(42);
+        std::vector<double> latencies;
+        std::vector<std::string> keys(BATCH), values;
+        std::vector<bool> found;
+        size_t hits = 0;
+        for (int round = 0; round < ROUNDS; ++round) {
+            for (auto& key : keys) key = makeKey(gen() % KEYS);
+            auto start = std::chrono::steady_clock::now();
+            hits += client.multiGet(keys, values, found);
+            latencies.push_back(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "节点数: " << nodeCount << "  批大小: " << BATCH
+                  << "  p50: " << latencies[latencies.size() / 2] << "us"
+                  << "  p99: " << latencies[latencies.size() * 99 / 100] << "us"
+                  << "  命中率: " << 100.0 * hits / (ROUNDS * BATCH) << "%" << std::endl;
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::signal(SIGPIPE, SIG_IGN);
+    const int NODES = 4;
+    std::vector<std::unique_ptr<LocalNode>> nodes;
+    for (int i = 0; i <= NODES; ++i) nodes.emplace_back(new LocalNode("node-" + std::to_string(i)));
+
+    testRemap(nodes);
+    testFanOut(nodes);
+    return 0;
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "KCacheItem.h"
+#include "KResponseBuffer.h"
+
+namespace KamaCache {
+
+// 紧凑二进制协议。请求与响应都是 16 字节定长头 + 变长数据（小端序）：
+//   magic(1) opcode(1) keyLength|status(2) flags(4) opaque(4) valueLength(4)
+// 请求头之后依次是 key 和 value；响应头之后是 value（仅 GET 命中时）。opaque 由客户端填写，响应原样带回
+namespace KBinaryProtocol {
+
+constexpr uint8_t kRequestMagic = 0xCA;
+constexpr uint8_t kResponseMagic = 0xCB;
+constexpr size_t kHeaderSize = 16;
+
+enum Opcode : uint8_t {
+    kGet = 0x01,
+    kSet = 0x02,
+    kDelete = 0x03,
+};
+
+enum Status : uint16_t {
+    kOk = 0,
+    kNotFound = 1,
+    kInvalid = 2,   // 无法识别的操作码或 key 过长
+    kTooLarge = 3,  // value 超过上限
+};
+
+struct Header {
+    uint8_t magic = 0;
+    uint8_t opcode = 0;
+    uint16_t keyLengthOrStatus = 0;  // 请求中为 key 长度，响应中为状态码
+    uint32_t flags = 0;
+    uint32_t opaque = 0;
+    uint32_t valueLength = 0;
+};
+
+inline void encodeHeader(const Header& header, char* out) {
+    auto put16 = [](char* p, uint16_t v) {
+        p[0] = static_cast<char>(v);
+        p[1] = static_cast<char>(v >> 8);
+    };
+    auto put32 = [](char* p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<char>(v >> (8 * i));
+    };
+    out[0] = static_cast<char>(header.magic);
+    out[1] = static_cast<char>(header.opcode);
+    put16(out + 2, header.keyLengthOrStatus);
+    put32(out + 4, header.flags);
+    put32(out + 8, header.opaque);
+    put32(out + 12, header.valueLength);
+}
+
+inline Header decodeHeader(const char* in) {
+    auto get16 = [](const char* p) {
+        return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+    };
+    auto get32 = [](const char* p) {
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; --i) v = (v << 8) | static_cast<uint8_t>(p[i]);
+        return v;
+    };
+    Header header;
+    header.magic = static_cast<uint8_t>(in[0]);
+    header.opcode = static_cast<uint8_t>(in[1]);
+    header.keyLengthOrStatus = get16(in + 2);
+    header.flags = get32(in + 4);
+    header.opaque = get32(in + 8);
+    header.valueLength = get32(in + 12);
+    return header;
+}
+
+// 在 out 末尾追加一个完整的请求帧
+inline void appendRequest(std::string& out,
+                          Opcode opcode,
+                          std::string_view key,
+                          std::string_view value = {},
+                          uint32_t flags = 0,
+                          uint32_t opaque = 0) {
+    Header header;
+    header.magic = kRequestMagic;
+    header.opcode = opcode;
+    header.keyLengthOrStatus = static_cast<uint16_t>(key.size());
+    header.flags = flags;
+    header.opaque = opaque;
+    header.valueLength = static_cast<uint32_t>(value.size());
+    char buf[kHeaderSize];
+    encodeHeader(header, buf);
+    out.append(buf, kHeaderSize);
+    out.append(key.data(), key.size());
+    out.append(value.data(), value.size());
+}
+
+}  // namespace KBinaryProtocol
+
+// 二进制协议的服务端处理：一次读事件中到达的所有请求先整体解析，连续的 GET/SET 合并成一次
+// getBatch/putBatch（分片缓存内部再按分片分组，每个分片只加一次锁），响应按请求顺序拼接后一次 writev 发出。
+// Cache 需要提供 getBatch、putBatch 和 remove，Key 为 std::string，Value 为 KCacheItemPtr
+template <typename Cache>
+class KBinaryProtocolHandler {
+public:
+    static constexpr size_t kMaxKeyLength = 250;
+    static constexpr size_t kMaxItemSize = 1024 * 1024;
+
+    explicit KBinaryProtocolHandler(Cache& cache) : cache_(cache) {}
+
+    // 执行 data 中所有完整的请求帧，响应追加到 out，返回已消费的字节数
+    size_t process(const char* data, size_t len, KResponseBuffer& out, bool& closeConnection) {
+        using namespace KBinaryProtocol;
+
+        // 1. 解析所有完整的请求帧
+        requests_.clear();
+        size_t pos = 0;
+        while (len - pos >= kHeaderSize) {
+            Header header = decodeHeader(data + pos);
+            if (header.magic != kRequestMagic) {
+                closeConnection = true;
+                break;
+            }
+            size_t frameSize = kHeaderSize + header.keyLengthOrStatus + header.valueLength;
+            if (header.valueLength > kMaxItemSize + kMaxKeyLength) {
+                // 帧长度明显异常，不再等待数据
+                closeConnection = true;
+                break;
+            }
+            if (len - pos < frameSize) break;
+
+            Request request;
+            request.header = header;
+            request.key = std::string(data + pos + kHeaderSize, header.keyLengthOrStatus);
+            request.value = std::string_view(data + pos + kHeaderSize + header.keyLengthOrStatus, header.valueLength);
+            requests_.push_back(std::move(request));
+            pos += frameSize;
+        }
+
+        // 2. 把连续的同类请求合并成批量操作执行
+        size_t begin = 0;
+        while (begin < requests_.size()) {
+            uint8_t opcode = requests_[begin].header.opcode;
+            size_t end = begin + 1;
+            if (opcode == kGet || opcode == kSet) {
+                while (end < requests_.size() && requests_[end].header.opcode == opcode) ++end;
+            }
+            execute(opcode, begin, end);
+            begin = end;
+        }
+
+        // 3. 按请求顺序组装响应
+        for (const Request& request : requests_) {
+            Header header;
+            header.magic = kResponseMagic;
+            header.opcode = request.header.opcode;
+            header.keyLengthOrStatus = request.status;
+            header.opaque = request.header.opaque;
+            if (request.item) {
+                header.flags = request.item->flags;
+                header.valueLength = static_cast<uint32_t>(request.item->data.size());
+            }
+            char buf[kHeaderSize];
+            encodeHeader(header, buf);
+            out.append(std::string_view(buf, kHeaderSize));
+            if (request.item) out.appendItem(request.item);
+        }
+        return pos;
+    }
+
+private:
+    struct Request {
+        KBinaryProtocol::Header header;
+        std::string key;
+        std::string_view value;  // 指向输入缓冲，本次 process 内有效
+        uint16_t status = KBinaryProtocol::kOk;
+        KCacheItemPtr item;      // GET 命中的结果
+    };
+
+    // 执行 requests_[begin, end)，它们的操作码相同
+    void execute(uint8_t opcode, size_t begin, size_t end) {
+        using namespace KBinaryProtocol;
+
+        size_t count = 0;
+        keys_.clear();
+        index_.clear();
+        for (size_t i = begin; i < end; ++i) {
+            Request& request = requests_[i];
+            if (request.key.size() > kMaxKeyLength || (opcode != kGet && opcode != kSet && opcode != kDelete)) {
+                request.status = kInvalid;
+            } else if (opcode == kSet && request.value.size() > kMaxItemSize) {
+                request.status = kTooLarge;
+            } else {
+                keys_.push_back(std::move(request.key));
+                index_.push_back(i);
+                ++count;
+            }
+        }
+        if (count == 0) return;
+
+        if (opcode == kGet) {
+            items_.assign(count, nullptr);
+            if (foundCapacity_ < count) {
+                found_.reset(new bool[count]);
+                foundCapacity_ = count;
+            }
+            cache_.getBatch(keys_.data(), count, items_.data(), found_.get());
+            for (size_t i = 0; i < count; ++i) {
+                Request& request = requests_[index_[i]];
+                if (found_[i] && items_[i]) {
+                    request.item = std::move(items_[i]);
+                } else {
+                    request.status = kNotFound;
+                }
+            }
+        } else if (opcode == kSet) {
+            items_.clear();
+            for (size_t i = 0; i < count; ++i) {
+                const Request& request = requests_[index_[i]];
+                items_.push_back(std::make_shared<const KCacheItem>(
+                    request.header.flags, nextCasUnique(), std::string(request.value)));
+            }
+            cache_.putBatch(keys_.data(), items_.data(), count);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                if (!cache_.remove(keys_[i])) requests_[index_[i]].status = kNotFound;
+            }
+        }
+    }
+
+private:
+    Cache& cache_;
+    // 以下容器在每次 process 间复用，避免重复分配
+    std::vector<Request> requests_;
+    std::vector<std::string> keys_;
+    std::vector<size_t> index_;
+    std::vector<KCacheItemPtr> items_;
+    std::unique_ptr<bool[]> found_;
+    size_t foundCapacity_ = 0;
+};
+
+}  // namespace KamaCache
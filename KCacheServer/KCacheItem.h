@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace KamaCache {
+
+// 服务端缓存的值：一经创建便不再修改，多个连接可以同时引用同一份数据
+struct KCacheItem {
+    uint32_t flags;    // 客户端自定义的标记位，原样返回
+    uint64_t cas;      // 写入时分配的唯一版本号（gets 命令返回）
+    std::string data;  // 值的字节内容
+
+    KCacheItem(uint32_t flags, uint64_t cas, std::string data) : flags(flags), cas(cas), data(std::move(data)) {}
+};
+
+// 缓存中保存的是指向不可变 item 的指针，get 时只拷贝指针，响应时直接引用 data 的内存
+using KCacheItemPtr = std::shared_ptr<const KCacheItem>;
+
+// 全局递增的 cas 版本号
+inline uint64_t nextCasUnique() {
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace KamaCache
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "KBinaryProtocol.h"
+#include "KMemcacheProtocol.h"
+#include "KResponseBuffer.h"
+
+namespace KamaCache {
+
+struct KCacheServerOptions {
+    std::string host = "0.0.0.0";  // TCP 监听地址
+    int tcpPort = 11211;           // TCP 端口：0 表示由系统分配，小于0 表示不监听 TCP
+    std::string unixPath;          // unix domain socket 路径，为空表示不监听
+    int threads = 0;               // 事件循环线程数，0 表示与 CPU 核数相同
+};
+
+// 基于 epoll 的缓存服务：每个线程一个事件循环（thread-per-core），连接由接受它的线程独占处理。
+// 每个连接根据收到的第一个字节选择协议：KBinaryProtocol 的 magic 为二进制协议，否则为 memcached 文本协议。
+// TCP 每个线程各自持有一个 SO_REUSEPORT 监听 socket，由内核分摊新连接；unix socket 共用一个监听 socket，
+// 以 EPOLLEXCLUSIVE 注册到各线程避免惊群。Cache 可以是任意提供 put/get/remove/getBatch/putBatch 的（分片）缓存
+template <typename Cache>
+class KCacheServer {
+public:
+    KCacheServer(Cache& cache, KCacheServerOptions options) : cache_(cache), options_(std::move(options)) {
+        if (options_.threads <= 0) options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ~KCacheServer() { stop(); }
+
+    KCacheServer(const KCacheServer&) = delete;
+    KCacheServer& operator=(const KCacheServer&) = delete;
+
+    // 创建监听 socket 并启动事件循环线程，失败时抛出 std::system_error
+    void start() {
+        if (options_.unixPath.size() > 0) unixListenFd_ = listenUnix(options_.unixPath);
+
+        for (int i = 0; i < options_.threads; ++i) {
+            int tcpFd = -1;
+            if (options_.tcpPort >= 0) {
+                tcpFd = listenTcp(options_.host, tcpPort_ > 0 ? tcpPort_ : options_.tcpPort);
+                if (tcpPort_ <= 0) tcpPort_ = localPort(tcpFd);
+            }
+            loops_.emplace_back(new EventLoop(cache_, tcpFd, unixListenFd_));
+        }
+        for (auto& loop : loops_) {
+            EventLoop* eventLoop = loop.get();
+            threads_.emplace_back([eventLoop] { eventLoop->run(); });
+        }
+    }
+
+    // 停止所有事件循环并关闭全部连接
+    void stop() {
+        for (auto& loop : loops_) loop->wakeup();
+        for (auto& thread : threads_) thread.join();
+        threads_.clear();
+        loops_.clear();
+        if (unixListenFd_ >= 0) {
+            ::close(unixListenFd_);
+            ::unlink(options_.unixPath.c_str());
+            unixListenFd_ = -1;
+        }
+    }
+
+    // 实际监听的 TCP 端口（配置为0时由系统分配）
+    int tcpPort() const { return tcpPort_; }
+
+private:
+    // 单个连接的状态
+    struct Connection {
+        int fd;
+        std::string input;                      // 已读取但未处理的数据
+        size_t inputOffset = 0;                 // input 中已处理的字节数
+        KResponseBuffer output;                 // 待发送的响应
+        bool protocolChosen = false;            // 已根据第一个字节选定协议
+        bool binary = false;                    // 是否使用二进制协议
+        KMemcacheTextProtocol<Cache> text;      // 文本协议解析状态
+        KBinaryProtocolHandler<Cache> binaryHandler;
+        bool closing = false;                   // 响应发送完后关闭
+        bool readPaused = false;                // 因待发送数据过多而暂停读取
+
+        Connection(int fd, Cache& cache) : fd(fd), text(cache), binaryHandler(cache) {}
+
+        size_t process(const char* data, size_t len, bool& close) {
+            return binary ? binaryHandler.process(data, len, output, close) : text.process(data, len, output, close);
+        }
+
+        ~Connection() { ::close(fd); }
+    };
+
+    class EventLoop {
+    public:
+        EventLoop(Cache& cache, int tcpListenFd, int unixListenFd)
+            : cache_(cache), tcpListenFd_(tcpListenFd), unixListenFd_(unixListenFd) {
+            epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+            wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (epollFd_ < 0 || wakeFd_ < 0) throw std::system_error(errno, std::generic_category(), "epoll");
+            addFd(wakeFd_, EPOLLIN);
+            if (tcpListenFd_ >= 0) addFd(tcpListenFd_, EPOLLIN);
+            if (unixListenFd_ >= 0) addFd(unixListenFd_, EPOLLIN | EPOLLEXCLUSIVE);
+        }
+
+        ~EventLoop() {
+            connections_.clear();
+            if (tcpListenFd_ >= 0) ::close(tcpListenFd_);
+            ::close(wakeFd_);
+            ::close(epollFd_);
+        }
+
+        void wakeup() {
+            uint64_t one = 1;
+            ssize_t n = ::write(wakeFd_, &one, sizeof(one));
+            (void)n;
+        }
+
+        void run() {
+            epoll_event events[kMaxEvents];
+            while (true) {
+                int n = ::epoll_wait(epollFd_, events, kMaxEvents, -1);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return;
+                }
+                for (int i = 0; i < n; ++i) {
+                    int fd = events[i].data.fd;
+                    if (fd == wakeFd_) return;
+                    if (fd == tcpListenFd_ || fd == unixListenFd_) {
+                        acceptAll(fd);
+                        continue;
+                    }
+
+                    auto it = connections_.find(fd);
+                    if (it == connections_.end()) continue;
+                    Connection* conn = it->second.get();
+                    bool alive = true;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP)) alive = false;
+                    if (alive && (events[i].events & EPOLLOUT)) alive = onWritable(conn);
+                    if (alive && (events[i].events & (EPOLLIN | EPOLLRDHUP))) alive = onReadable(conn);
+                    if (!alive) connections_.erase(it);
+                }
+            }
+        }
+
+    private:
+        static constexpr int kMaxEvents = 256;
+        static constexpr size_t kReadChunk = 16 * 1024;
+        static constexpr size_t kMaxPendingOutput = 4 * 1024 * 1024;  // 超过后暂停读取，等待对端接收
+
+        void addFd(int fd, uint32_t events) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.fd = fd;
+            if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+            }
+        }
+
+        void acceptAll(int listenFd) {
+            while (true) {
+                int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED) continue;
+                    return;  // EAGAIN，或 fd 耗尽时等下一次事件再试
+                }
+                if (listenFd == tcpListenFd_) {
+                    int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+                connections_[fd] = std::make_unique<Connection>(fd, cache_);
+                // 边缘触发，读写事件只注册一次
+                epoll_event ev{};
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                ev.data.fd = fd;
+                if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) connections_.erase(fd);
+            }
+        }
+
+        // 读取到 EAGAIN 为止，执行其中所有完整的命令后统一发送响应 | 连接需要关闭时返回false
+        bool onReadable(Connection* conn) {
+            conn->readPaused = false;
+            while (!conn->closing) {
+                // 对端接收过慢时先尝试发送，仍发不出去则暂停读取，等 EPOLLOUT 后再继续
+                if (conn->output.pendingBytes() >= kMaxPendingOutput) {
+                    bool wouldBlock = false;
+                    if (!conn->output.flush(conn->fd, wouldBlock)) return false;
+                    if (wouldBlock) {
+                        conn->readPaused = true;
+                        return true;
+                    }
+                }
+
+                size_t oldSize = conn->input.size();
+                conn->input.resize(oldSize + kReadChunk);
+                ssize_t n = ::read(conn->fd, &conn->input[oldSize], kReadChunk);
+                conn->input.resize(oldSize + (n > 0 ? n : 0));
+                if (n > 0) {
+                    processInput(conn);
+                    continue;
+                }
+                if (n == 0) {
+                    // 对端关闭写方向：尽力发出已有响应后关闭
+                    flush(conn);
+                    return false;
+                }
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+            if (!flush(conn)) return false;
+            return !(conn->closing && conn->output.empty());
+        }
+
+        bool onWritable(Connection* conn) {
+            if (!flush(conn)) return false;
+            if (conn->closing) return !conn->output.empty();
+            // 写缓冲排空后继续处理因背压而暂停的输入（边缘触发不会再次通知已到达的数据）
+            if (conn->readPaused && conn->output.empty()) return onReadable(conn);
+            return true;
+        }
+
+        void processInput(Connection* conn) {
+            bool close = false;
+            if (!conn->protocolChosen) {
+                // 连接上的第一个字节决定协议
+                conn->binary = static_cast<uint8_t>(conn->input[0]) == KBinaryProtocol::kRequestMagic;
+                conn->protocolChosen = true;
+            }
+            size_t consumed = conn->process(
+                conn->input.data() + conn->inputOffset, conn->input.size() - conn->inputOffset, close);
+            conn->inputOffset += consumed;
+            if (close) conn->closing = true;
+            // 已处理的数据超过一半时再整体前移，避免每次都搬移
+            if (conn->inputOffset == conn->input.size()) {
+                conn->input.clear();
+                conn->inputOffset = 0;
+            } else if (conn->inputOffset > conn->input.size() / 2) {
+                conn->input.erase(0, conn->inputOffset);
+                conn->inputOffset = 0;
+            }
+        }
+
+        bool flush(Connection* conn) {
+            bool wouldBlock = false;
+            return conn->output.flush(conn->fd, wouldBlock);
+        }
+
+    private:
+        Cache& cache_;
+        int epollFd_ = -1;
+        int wakeFd_ = -1;
+        int tcpListenFd_ = -1;   // 本线程独占
+        int unixListenFd_ = -1;  // 所有线程共享，由 KCacheServer 关闭
+        std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    };
+
+    static int listenTcp(const std::string& host, int port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "socket");
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            ::close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), "invalid listen address " + host);
+        }
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "listen on port " + std::to_string(port));
+        }
+        return fd;
+    }
+
+    static int listenUnix(const std::string& path) {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw std::system_error(ENAMETOOLONG, std::generic_category(), "unix socket path " + path);
+        }
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        ::unlink(path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "listen on " + path);
+        }
+        return fd;
+    }
+
+    static int localPort(int fd) {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        return ntohs(addr.sin_port);
+    }
+
+private:
+    Cache& cache_;
+    KCacheServerOptions options_;
+    int tcpPort_ = 0;
+    int unixListenFd_ = -1;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "KCacheItem.h"
+#include "KResponseBuffer.h"
+
+namespace KamaCache {
+
+// memcached 文本协议（get/gets/set/delete 子集）。每个连接持有一个实例，保存跨读事件的解析状态。
+// Cache 需要提供 put(key, item)、get(key, item) 和 remove(key)，Key 为 std::string，Value 为 KCacheItemPtr
+template <typename Cache>
+class KMemcacheTextProtocol {
+public:
+    static constexpr size_t kMaxKeyLength = 250;          // 与 memcached 一致
+    static constexpr size_t kMaxItemSize = 1024 * 1024;   // 单个 value 的上限
+    static constexpr size_t kMaxLineLength = 64 * 1024;   // 多 key 的 get 命令行可能较长
+
+    explicit KMemcacheTextProtocol(Cache& cache) : cache_(cache) {}
+
+    // 依次执行 data 中所有完整的命令（流水线），响应追加到 out，返回已消费的字节数。
+    // 不完整的命令留待更多数据到达；需要关闭连接时置 closeConnection
+    size_t process(const char* data, size_t len, KResponseBuffer& out, bool& closeConnection) {
+        size_t pos = 0;
+        while (pos < len && !closeConnection) {
+            // 丢弃过大 value 的剩余数据
+            if (swallowBytes_ > 0) {
+                size_t n = std::min(swallowBytes_, len - pos);
+                swallowBytes_ -= n;
+                pos += n;
+                continue;
+            }
+
+            const char* lineEnd = static_cast<const char*>(std::memchr(data + pos, '\n', len - pos));
+            if (lineEnd == nullptr) {
+                if (len - pos > kMaxLineLength) {
+                    out.append("CLIENT_ERROR line too long\r\n");
+                    closeConnection = true;
+                }
+                break;
+            }
+
+            size_t lineLength = lineEnd - (data + pos);
+            std::string_view line(data + pos, lineLength);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            size_t next = pos + lineLength + 1;
+
+            tokenize(line);
+            if (tokens_.empty()) {
+                out.append("ERROR\r\n");
+                pos = next;
+                continue;
+            }
+
+            std::string_view cmd = tokens_[0];
+            if (cmd == "get" || cmd == "gets") {
+                processGet(out, cmd == "gets");
+            } else if (cmd == "set") {
+                // set 命令需要等待数据块完整到达
+                size_t consumed = processSet(data + next, len - next, out, closeConnection);
+                if (consumed == kIncomplete) break;
+                next += consumed;
+            } else if (cmd == "delete") {
+                processDelete(out);
+            } else if (cmd == "version") {
+                out.append("VERSION kamacache-1.0\r\n");
+            } else if (cmd == "quit") {
+                closeConnection = true;
+            } else {
+                out.append("ERROR\r\n");
+            }
+            pos = next;
+        }
+        return pos;
+    }
+
+private:
+    static constexpr size_t kIncomplete = static_cast<size_t>(-1);
+
+    void tokenize(std::string_view line) {
+        tokens_.clear();
+        size_t i = 0;
+        while (i < line.size()) {
+            while (i < line.size() && line[i] == ' ') ++i;
+            size_t start = i;
+            while (i < line.size() && line[i] != ' ') ++i;
+            if (i > start) tokens_.push_back(line.substr(start, i - start));
+        }
+    }
+
+    template <typename T>
+    static bool parseNumber(std::string_view s, T& value) {
+        auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+        return result.ec == std::errc() && result.ptr == s.data() + s.size();
+    }
+
+    // get <key>*
+    void processGet(KResponseBuffer& out, bool withCas) {
+        if (tokens_.size() < 2) {
+            out.append("ERROR\r\n");
+            return;
+        }
+        // 先检查所有 key：输出 VALUE 之后再报错会破坏响应的分帧
+        for (size_t i = 1; i < tokens_.size(); ++i) {
+            if (tokens_[i].size() > kMaxKeyLength) {
+                out.append("CLIENT_ERROR bad command line format\r\n");
+                return;
+            }
+        }
+        for (size_t i = 1; i < tokens_.size(); ++i) {
+            KCacheItemPtr item;
+            if (!cache_.get(std::string(tokens_[i]), item) || !item) continue;
+
+            char header[64];
+            int n = withCas ? snprintf(header,
+                                       sizeof(header),
+                                       " %u %zu %llu\r\n",
+                                       item->flags,
+                                       item->data.size(),
+                                       static_cast<unsigned long long>(item->cas))
+                            : snprintf(header, sizeof(header), " %u %zu\r\n", item->flags, item->data.size());
+            out.append("VALUE ");
+            out.append(tokens_[i]);
+            out.append(std::string_view(header, n));
+            out.appendItem(item);
+            out.append("\r\n");
+        }
+        out.append("END\r\n");
+    }
+
+    // set <key> <flags> <exptime> <bytes> [noreply]\r\n<data>\r\n
+    // 返回数据块（含结尾\r\n）占用的字节数，数据未到齐时返回 kIncomplete
+    size_t processSet(const char* data, size_t len, KResponseBuffer& out, bool& closeConnection) {
+        uint32_t flags = 0;
+        long long exptime = 0;
+        size_t bytes = 0;
+        if (tokens_.size() < 5 || tokens_.size() > 6 || tokens_[1].size() > kMaxKeyLength
+            || !parseNumber(tokens_[2], flags) || !parseNumber(tokens_[3], exptime)
+            || !parseNumber(tokens_[4], bytes)) {
+            out.append("CLIENT_ERROR bad command line format\r\n");
+            closeConnection = true;
+            return 0;
+        }
+        bool noreply = tokens_.size() == 6 && tokens_[5] == "noreply";
+
+        if (bytes > kMaxItemSize) {
+            out.append("SERVER_ERROR object too large for cache\r\n");
+            swallowBytes_ = bytes + 2;
+            return 0;
+        }
+        if (len < bytes + 2) return kIncomplete;
+        if (data[bytes] != '\r' || data[bytes + 1] != '\n') {
+            out.append("CLIENT_ERROR bad data chunk\r\n");
+            closeConnection = true;
+            return 0;
+        }
+
+        // 引擎目前没有过期时间的概念，exptime 只做格式校验
+        cache_.put(std::string(tokens_[1]),
+                   std::make_shared<const KCacheItem>(flags, nextCasUnique(), std::string(data, bytes)));
+        if (!noreply) out.append("STORED\r\n");
+        return bytes + 2;
+    }
+
+    // delete <key> [0] [noreply]
+    void processDelete(KResponseBuffer& out) {
+        if (tokens_.size() < 2 || tokens_.size() > 4 || tokens_[1].size() > kMaxKeyLength) {
+            out.append("CLIENT_ERROR bad command line format\r\n");
+            return;
+        }
+        bool noreply = tokens_.back() == "noreply";
+        bool removed = cache_.remove(std::string(tokens_[1]));
+        if (!noreply) out.append(removed ? "DELETED\r\n" : "NOT_FOUND\r\n");
+    }
+
+private:
+    Cache& cache_;
+    std::vector<std::string_view> tokens_;  // 当前命令行的分词结果（复用以避免分配）
+    size_t swallowBytes_ = 0;                // 待丢弃的数据字节数
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <climits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "KCacheItem.h"
+
+namespace KamaCache {
+
+// 连接的待发送数据：协议头等小块数据拷贝进内部缓冲，value 只记录 item 的引用，
+// 发送时把两者拼成 iovec 数组交给 writev，value 的字节不会被拷贝
+class KResponseBuffer {
+public:
+    bool empty() const { return head_ == segments_.size(); }
+
+    // 待发送的字节数
+    size_t pendingBytes() const { return pendingBytes_; }
+
+    // 拷贝一段数据到内部缓冲
+    void append(std::string_view data) {
+        if (data.empty()) return;
+        // 与上一段内部缓冲相邻时直接合并，减少 iovec 数量
+        if (!empty() && segments_.back().item == nullptr
+            && segments_.back().offset + segments_.back().length == bytes_.size()) {
+            segments_.back().length += data.size();
+        } else {
+            segments_.push_back({nullptr, bytes_.size(), data.size()});
+        }
+        bytes_.append(data.data(), data.size());
+        pendingBytes_ += data.size();
+    }
+
+    // 引用 item 的数据，发送完成前持有 item
+    void appendItem(const KCacheItemPtr& item) {
+        if (item->data.empty()) return;
+        segments_.push_back({item.get(), 0, item->data.size()});
+        items_.push_back(item);
+        pendingBytes_ += item->data.size();
+    }
+
+    // 尽可能多地写出数据。写缓冲已满时置 wouldBlock | 连接出错返回false
+    bool flush(int fd, bool& wouldBlock) {
+        wouldBlock = false;
+        while (!empty()) {
+            iovec iov[kMaxIov];
+            int iovCount = 0;
+            for (size_t i = head_; i < segments_.size() && iovCount < kMaxIov; ++i) {
+                const Segment& seg = segments_[i];
+                const char* base = seg.item ? seg.item->data.data() : bytes_.data();
+                size_t skip = (i == head_) ? headOffset_ : 0;
+                iov[iovCount].iov_base = const_cast<char*>(base + seg.offset + skip);
+                iov[iovCount].iov_len = seg.length - skip;
+                ++iovCount;
+            }
+
+            ssize_t n = ::writev(fd, iov, iovCount);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    wouldBlock = true;
+                    return true;
+                }
+                return false;
+            }
+            consume(static_cast<size_t>(n));
+        }
+        clear();
+        return true;
+    }
+
+    void clear() {
+        bytes_.clear();
+        segments_.clear();
+        items_.clear();
+        head_ = 0;
+        headOffset_ = 0;
+        pendingBytes_ = 0;
+    }
+
+private:
+    struct Segment {
+        const KCacheItem* item;  // 为空表示数据位于 bytes_ 中
+        size_t offset;
+        size_t length;
+    };
+
+    // 前移已写出的进度
+    void consume(size_t n) {
+        pendingBytes_ -= n;
+        while (n > 0) {
+            size_t left = segments_[head_].length - headOffset_;
+            if (n < left) {
+                headOffset_ += n;
+                return;
+            }
+            n -= left;
+            ++head_;
+            headOffset_ = 0;
+        }
+    }
+
+private:
+    static constexpr int kMaxIov = IOV_MAX < 256 ? IOV_MAX : 256;  // 单次 writev 的最大分段数
+
+    std::string bytes_;                  // 协议头等小块数据
+    std::vector<Segment> segments_;      // 按发送顺序排列的数据段
+    std::vector<KCacheItemPtr> items_;   // 发送完成前持有被引用的 item
+    size_t head_ = 0;                    // 第一个未写完的数据段
+    size_t headOffset_ = 0;              // 第一个数据段中已写出的字节数
+    size_t pendingBytes_ = 0;
+};
+
+}  // namespace KamaCache
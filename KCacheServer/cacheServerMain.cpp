@@ -0,0 +1,101 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "../KLfuCache.h"
+#include "../KLruCache.h"
+#include "KCacheItem.h"
+#include "KCacheServer.h"
+
+namespace {
+
+struct ServerArgs {
+    KamaCache::KCacheServerOptions options;
+    std::string engine = "lru";  // lru | lfu
+    size_t capacity = 1000000;   // 缓存条目总数
+    int slices = 0;              // 分片数量，0 表示与 CPU 核数相同
+};
+
+void printUsage(const char* prog) {
+    std::cout << "用法: " << prog
+              << " [--host ADDR] [--port N] [--unix PATH] [--threads N]"
+                 " [--engine lru|lfu] [--capacity N] [--slices N]\n"
+                 "  --port -1 表示不监听 TCP\n";
+}
+
+bool parseArgs(int argc, char** argv, ServerArgs& args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "--host") {
+            args.options.host = value;
+        } else if (arg == "--port") {
+            args.options.tcpPort = std::atoi(value.c_str());
+        } else if (arg == "--unix") {
+            args.options.unixPath = value;
+        } else if (arg == "--threads") {
+            args.options.threads = std::atoi(value.c_str());
+        } else if (arg == "--engine") {
+            args.engine = value;
+        } else if (arg == "--capacity") {
+            args.capacity = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--slices") {
+            args.slices = std::atoi(value.c_str());
+        } else {
+            return false;
+        }
+    }
+    return args.engine == "lru" || args.engine == "lfu";
+}
+
+// 启动服务并阻塞到收到 SIGINT/SIGTERM
+template <typename Cache>
+int serve(Cache& cache, const ServerArgs& args, const sigset_t& signals) {
+    KamaCache::KCacheServer<Cache> server(cache, args.options);
+    try {
+        server.start();
+    } catch (const std::exception& e) {
+        std::cerr << "启动失败: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "kcache_server 已启动: engine=" << args.engine << " capacity=" << args.capacity;
+    if (args.options.tcpPort >= 0) std::cout << " tcp=" << args.options.host << ":" << server.tcpPort();
+    if (!args.options.unixPath.empty()) std::cout << " unix=" << args.options.unixPath;
+    std::cout << std::endl;
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+    std::cout << "收到信号 " << sig << "，正在退出" << std::endl;
+    server.stop();
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ServerArgs args;
+    if (!parseArgs(argc, argv, args)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // 对端断开时 writev 返回 EPIPE 而不是终止进程
+    std::signal(SIGPIPE, SIG_IGN);
+    // 在创建事件循环线程之前屏蔽退出信号，由主线程 sigwait 统一处理
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    if (args.engine == "lfu") {
+        KamaCache::KHashLfuCache<std::string, KamaCache::KCacheItemPtr> cache(args.capacity, args.slices);
+        return serve(cache, args, signals);
+    }
+    KamaCache::KHashLruCaches<std::string, KamaCache::KCacheItemPtr> cache(args.capacity, args.slices);
+    return serve(cache, args, signals);
+}
@@ -0,0 +1,325 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KBinaryProtocol.h"
+
+// kcache_server 的压测客户端：每个线程一条连接，按流水线深度批量发送请求并等待全部响应
+namespace {
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 11211;
+    std::string unixPath;  // 非空时通过 unix socket 连接
+    int threads = 4;
+    int seconds = 5;
+    int pipeline = 16;     // 每批发送的请求数
+    int keys = 100000;     // key 空间大小
+    int valueSize = 100;
+    int getRatio = 90;     // get 请求所占百分比
+    bool binary = false;   // 使用二进制协议（默认文本协议）
+};
+
+struct ThreadResult {
+    uint64_t ops = 0;
+    uint64_t gets = 0;
+    uint64_t hits = 0;
+    std::vector<double> batchLatencyUs;
+};
+
+int connectTo(const LoadOptions& options) {
+    int fd = -1;
+    if (!options.unixPath.empty()) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, options.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            throw std::runtime_error("connect " + options.unixPath + ": " + std::strerror(errno));
+        }
+        return fd;
+    }
+
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    ::inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        throw std::runtime_error("connect " + options.host + ":" + std::to_string(options.port) + ": "
+                                 + std::strerror(errno));
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error(std::string("write: ") + std::strerror(errno));
+        sent += n;
+    }
+}
+
+// 带缓冲的阻塞读取
+class SocketReader {
+public:
+    explicit SocketReader(int fd) : fd_(fd) {}
+
+    std::string readLine() {
+        while (true) {
+            size_t pos = buffer_.find("\r\n", offset_);
+            if (pos != std::string::npos) {
+                std::string line = buffer_.substr(offset_, pos - offset_);
+                offset_ = pos + 2;
+                return line;
+            }
+            fill();
+        }
+    }
+
+    // 读取 n 个字节
+    std::string read(size_t n) {
+        while (buffer_.size() - offset_ < n) fill();
+        std::string data = buffer_.substr(offset_, n);
+        offset_ += n;
+        return data;
+    }
+
+    void skip(size_t n) {
+        while (buffer_.size() - offset_ < n) fill();
+        offset_ += n;
+    }
+
+private:
+    void fill() {
+        if (offset_ > 0) {
+            buffer_.erase(0, offset_);
+            offset_ = 0;
+        }
+        char chunk[16 * 1024];
+        ssize_t n = ::read(fd_, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) return;
+        if (n <= 0) throw std::runtime_error("connection closed by server");
+        buffer_.append(chunk, n);
+    }
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t offset_ = 0;
+};
+
+// 读取一条 get 的响应，返回是否命中
+bool readGetResponse(SocketReader& reader) {
+    bool hit = false;
+    while (true) {
+        std::string line = reader.readLine();
+        if (line == "END") return hit;
+        if (line.compare(0, 6, "VALUE ") != 0) throw std::runtime_error("unexpected response: " + line);
+        size_t bytes = std::strtoull(line.c_str() + line.rfind(' ') + 1, nullptr, 10);
+        reader.skip(bytes + 2);
+        hit = true;
+    }
+}
+
+void expectLine(SocketReader& reader, const char* expected) {
+    std::string line = reader.readLine();
+    if (line != expected) throw std::runtime_error("unexpected response: " + line);
+}
+
+// 读取一条二进制协议的响应，返回状态码
+uint16_t readBinaryResponse(SocketReader& reader) {
+    using namespace KamaCache::KBinaryProtocol;
+    Header header = decodeHeader(reader.read(kHeaderSize).data());
+    if (header.magic != kResponseMagic) throw std::runtime_error("unexpected binary response magic");
+    reader.skip(header.valueLength);
+    return header.keyLengthOrStatus;
+}
+
+std::string makeKey(int k) { return "key:" + std::to_string(k); }
+
+void appendSet(std::string& request, const std::string& key, const std::string& value, bool binary) {
+    if (binary) {
+        KamaCache::KBinaryProtocol::appendRequest(request, KamaCache::KBinaryProtocol::kSet, key, value);
+        return;
+    }
+    request += "set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n";
+    request += value;
+    request += "\r\n";
+}
+
+void appendGet(std::string& request, const std::string& key, bool binary) {
+    if (binary) {
+        KamaCache::KBinaryProtocol::appendRequest(request, KamaCache::KBinaryProtocol::kGet, key);
+        return;
+    }
+    request += "get " + key + "\r\n";
+}
+
+// 读取一条 set 的响应
+void readSetResponse(SocketReader& reader, bool binary) {
+    if (!binary) {
+        expectLine(reader, "STORED");
+    } else if (readBinaryResponse(reader) != KamaCache::KBinaryProtocol::kOk) {
+        throw std::runtime_error("binary set failed");
+    }
+}
+
+void runThread(const LoadOptions& options,
+               int threadIndex,
+               std::chrono::steady_clock::time_point deadline,
+               ThreadResult& result) {
+    int fd = connectTo(options);
+    SocketReader reader(fd);
+    const std::string value(options.valueSize, 'v');
+
+    // 预热：每个线程写入自己负责的那部分 key
+    std::string request;
+    int pending = 0;
+    for (int k = threadIndex; k < options.keys; k += options.threads) {
+        appendSet(request, makeKey(k), value, options.binary);
+        if (++pending == options.pipeline || k + options.threads >= options.keys) {
+            sendAll(fd, request);
+            for (int i = 0; i < pending; ++i) readSetResponse(reader, options.binary);
+            request.clear();
+            pending = 0;
+        }
+    }
+
+    std::mt19937 gen(threadIndex * 7919 + 17);
+    std::vector<bool> isGet(options.pipeline);
+    while (std::chrono::steady_clock::now() < deadline) {
+        request.clear();
+        for (int i = 0; i < options.pipeline; ++i) {
+            std::string key = makeKey(gen() % options.keys);
+            isGet[i] = static_cast<int>(gen() % 100) < options.getRatio;
+            if (isGet[i]) {
+                appendGet(request, key, options.binary);
+            } else {
+                appendSet(request, key, value, options.binary);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        sendAll(fd, request);
+        for (int i = 0; i < options.pipeline; ++i) {
+            if (isGet[i]) {
+                ++result.gets;
+                bool hit = options.binary ? readBinaryResponse(reader) == KamaCache::KBinaryProtocol::kOk
+                                          : readGetResponse(reader);
+                if (hit) ++result.hits;
+            } else {
+                readSetResponse(reader, options.binary);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        result.batchLatencyUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        result.ops += options.pipeline;
+    }
+    ::close(fd);
+}
+
+bool parseArgs(int argc, char** argv, LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value.c_str());
+        } else if (arg == "--unix") {
+            options.unixPath = value;
+        } else if (arg == "--threads") {
+            options.threads = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--seconds") {
+            options.seconds = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--pipeline") {
+            options.pipeline = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--keys") {
+            options.keys = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--value-size") {
+            options.valueSize = std::max(0, std::atoi(value.c_str()));
+        } else if (arg == "--get-ratio") {
+            options.getRatio = std::atoi(value.c_str());
+        } else if (arg == "--protocol") {
+            if (value != "text" && value != "binary") return false;
+            options.binary = value == "binary";
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cout << "用法: " << argv[0]
+                  << " [--host ADDR] [--port N] [--unix PATH] [--threads N] [--seconds N]"
+                     " [--pipeline N] [--keys N] [--value-size N] [--get-ratio 0-100] [--protocol text|binary]\n";
+        return 1;
+    }
+
+    std::vector<ThreadResult> results(options.threads);
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed{false};
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.seconds);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < options.threads; ++t) {
+        threads.emplace_back([&, t] {
+            try {
+                runThread(options, t, deadline, results[t]);
+            } catch (const std::exception& e) {
+                std::cerr << "线程 " << t << " 出错: " << e.what() << std::endl;
+                failed = true;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (failed) return 1;
+
+    ThreadResult total;
+    for (auto& r : results) {
+        total.ops += r.ops;
+        total.gets += r.gets;
+        total.hits += r.hits;
+        total.batchLatencyUs.insert(total.batchLatencyUs.end(), r.batchLatencyUs.begin(), r.batchLatencyUs.end());
+    }
+    std::sort(total.batchLatencyUs.begin(), total.batchLatencyUs.end());
+    auto percentile = [&](double p) {
+        if (total.batchLatencyUs.empty()) return 0.0;
+        return total.batchLatencyUs[static_cast<size_t>(p * (total.batchLatencyUs.size() - 1))];
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "协议: " << (options.binary ? "binary" : "text") << "  线程数: " << options.threads
+              << "  流水线深度: " << options.pipeline << std::endl;
+    std::cout << "吞吐: " << total.ops / elapsed << " ops/s" << std::endl;
+    std::cout << "命中率: " << (total.gets ? 100.0 * total.hits / total.gets : 0.0) << "%" << std::endl;
+    std::cout << "批次延迟 p50: " << percentile(0.5) << "us  p99: " << percentile(0.99) << "us" << std::endl;
+    return 0;
+}
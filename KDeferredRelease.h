@@ -0,0 +1,39 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace KamaCache {
+
+// 收集临界区内被淘汰、删除或覆盖的 value，在解锁之后才析构，持锁时间不再取决于 value 的大小（例如几 MB 的缓冲区）。
+// 用法：在 lock_guard 之前声明，局部变量按声明的逆序析构，锁先释放，value 随后在调用线程中释放：
+//     KDeferredRelease<Value> released;
+//     std::lock_guard<std::mutex> lock(mutex_);
+//     released.add(node->value_);
+// 只移走 value 本身，结点仍在锁内释放：结点可能来自只能在分片锁内使用的 memory_resource（见 KAllocator.h）。
+// 绝大多数操作最多淘汰一个元素，第一个 value 存放在对象内部，不额外分配内存
+template <typename Value>
+class KDeferredRelease {
+public:
+    KDeferredRelease() = default;
+    KDeferredRelease(const KDeferredRelease&) = delete;
+    KDeferredRelease& operator=(const KDeferredRelease&) = delete;
+
+    // 移走 value 的内容，原处留下移动后的对象
+    void add(Value& value) {
+        if (!first_) {
+            first_.emplace(std::move(value));
+        } else {
+            rest_.push_back(std::move(value));
+        }
+    }
+
+    size_t size() const { return first_ ? 1 + rest_.size() : 0; }
+
+private:
+    std::optional<Value> first_;
+    std::vector<Value> rest_;
+};
+
+}  // namespace KamaCache
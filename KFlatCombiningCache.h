@@ -0,0 +1,241 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "KICachePolicy.h"
+#include "KLruCache.h"
+#include "KReshard.h"
+
+namespace KamaCache {
+
+// 平面合并（flat combining）模式的 LRU 分片：线程把 get/put/remove 请求写入自己的槽位，
+// 抢到合并锁的线程一次执行所有槽位中待处理的请求并写回结果，其余线程只在自己的槽位上等待。
+// 热点分片上不再是每个线程轮流争抢互斥锁、链表与哈希表在线程之间来回迁移，而是由一个线程趁缓存行还热时批量完成，
+// 线程增加时吞吐不会随锁竞争崩溃。槽位按线程编号取模分配，两个线程落在同一槽位时后来者直接加锁自己执行。
+// Mutex 为合并锁与内部 KLruCache 的锁的类型，见 KLock.h
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KFlatCombiningLruCache : public KICachePolicy<Key, Value> {
+public:
+    static constexpr int kSlots = 64;  // 槽位个数，超过该数目的线程共用槽位
+
+    KFlatCombiningLruCache(int capacity) : cache_(capacity) {}
+
+    ~KFlatCombiningLruCache() override = default;
+
+    void put(Key key, Value value) override {
+        Request request{Op::Put, key};
+        request.value = std::move(value);
+        execute(request);
+    }
+
+    bool get(Key key, Value& value) override {
+        Request request{Op::Get, key};
+        execute(request);
+        if (request.found) value = std::move(request.value);
+        return request.found;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        Request request{Op::Remove, key};
+        execute(request);
+        return request.found;
+    }
+
+    void purge() {
+        std::lock_guard<Mutex> lock(combinerLock_);
+        cache_.purge();
+    }
+
+    // 以下供 KReshardableSlices 迁移元素与调整容量使用，调用不频繁，直接持合并锁执行
+    bool putIfAbsent(Key key, Value value) {
+        std::lock_guard<Mutex> lock(combinerLock_);
+        return cache_.putIfAbsent(key, std::move(value));
+    }
+
+    size_t extract(const Key* keys, size_t count, std::vector<std::pair<Key, Value>>& out) {
+        std::lock_guard<Mutex> lock(combinerLock_);
+        return cache_.extract(keys, count, out);
+    }
+
+    void collectKeys(std::vector<Key>& out) {
+        std::lock_guard<Mutex> lock(combinerLock_);
+        cache_.collectKeys(out);
+    }
+
+    void setCapacity(int capacity) {
+        std::lock_guard<Mutex> lock(combinerLock_);
+        cache_.setCapacity(capacity);
+    }
+
+    // 合并执行的批次数与请求数，两者之比为平均每批合并的请求个数
+    size_t combinedBatches() const { return batches_.load(std::memory_order_relaxed); }
+    size_t combinedRequests() const { return requests_.load(std::memory_order_relaxed); }
+
+private:
+    enum class Op { Get, Put, Remove };
+
+    struct Request {
+        Op op;
+        Key key;
+        Value value{};
+        bool found = false;
+    };
+
+    enum State { kEmpty, kPending, kDone };
+
+    // 每个槽位独占一个缓存行，发布请求不与其他线程的槽位伪共享
+    struct alignas(64) Slot {
+        std::atomic<bool> claimed{false};  // 是否有线程正在使用该槽位
+        std::atomic<int> state{kEmpty};
+        Request* request = nullptr;  // 指向发布线程栈上的请求，state 为 kPending 期间有效
+    };
+
+    void execute(Request& request) {
+        // 合并锁空闲时直接执行，顺便处理已发布的请求；没有竞争时不经过槽位
+        if (combinerLock_.try_lock()) {
+            apply(request);
+            if (pending_.load(std::memory_order_acquire) > 0) combine();
+            combinerLock_.unlock();
+            return;
+        }
+
+        Slot& slot = slots_[threadIndex() % kSlots];
+        if (slot.claimed.exchange(true, std::memory_order_acquire)) {
+            // 槽位被同余的线程占用，直接加锁执行
+            std::lock_guard<Mutex> lock(combinerLock_);
+            apply(request);
+            return;
+        }
+
+        slot.request = &request;
+        slot.state.store(kPending, std::memory_order_release);
+        pending_.fetch_add(1, std::memory_order_release);
+        for (int spins = 0; slot.state.load(std::memory_order_acquire) != kDone; ++spins) {
+            if (combinerLock_.try_lock()) {
+                combine();
+                combinerLock_.unlock();
+            } else if (spins > kSpinsBeforeYield) {
+                std::this_thread::yield();
+            }
+        }
+        slot.state.store(kEmpty, std::memory_order_relaxed);
+        slot.claimed.store(false, std::memory_order_release);
+    }
+
+    // 持有合并锁时调用：扫描所有槽位执行待处理的请求，没有待处理的请求时结束
+    void combine() {
+        size_t combined = 0;
+        for (int pass = 0; pass < kCombinePasses && pending_.load(std::memory_order_acquire) > 0; ++pass) {
+            size_t found = 0;
+            for (Slot& slot : slots_) {
+                if (slot.state.load(std::memory_order_acquire) != kPending) continue;
+                apply(*slot.request);
+                slot.state.store(kDone, std::memory_order_release);
+                ++found;
+            }
+            pending_.fetch_sub(found, std::memory_order_relaxed);
+            combined += found;
+        }
+        if (combined > 0) {
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            requests_.fetch_add(combined, std::memory_order_relaxed);
+        }
+    }
+
+    void apply(Request& request) {
+        switch (request.op) {
+            case Op::Get:
+                request.found = cache_.get(request.key, request.value);
+                break;
+            case Op::Put:
+                cache_.put(request.key, std::move(request.value));
+                break;
+            case Op::Remove:
+                request.found = cache_.remove(request.key);
+                break;
+        }
+    }
+
+    // 每个线程一个固定的编号，决定它使用的槽位
+    static size_t threadIndex() {
+        static std::atomic<size_t> nextIndex{0};
+        thread_local size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+private:
+    static constexpr int kSpinsBeforeYield = 64;  // 等待结果时先自旋，之后让出 CPU
+    static constexpr int kCombinePasses = 3;      // 合并线程最多扫描的轮数
+
+    KLruCache<Key, Value, KDefaultAlloc, Mutex> cache_;  // 只由持有合并锁的线程访问，其内部的互斥锁不再有竞争
+    Mutex combinerLock_;                                 // 合并锁
+    Slot slots_[kSlots];
+    std::atomic<size_t> pending_{0};  // 已发布、尚未执行的请求个数，为 0 时合并线程不扫描槽位
+    std::atomic<size_t> batches_{0};
+    std::atomic<size_t> requests_{0};
+};
+
+// 平面合并 LRU 的分片版本，适合少数分片承担大部分访问的热点负载。分片由 KReshardableSlices 管理，
+// 与 KHashLruCaches 使用相同的分片选择，可在线调整分片数与分片哈希种子
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KHashFlatCombiningLruCaches {
+public:
+    using SliceType = KFlatCombiningLruCache<Key, Value, Mutex>;
+    using Shards = KReshardableSlices<Key, Value, SliceType>;
+
+    KHashFlatCombiningLruCaches(size_t capacity, int sliceNum)
+        : shards_(capacity, sliceNum, [](int, size_t sliceSize) { return new SliceType(sliceSize); }) {}
+
+    void put(Key key, Value value) {
+        shards_.write(key, [&](SliceType& slice) { slice.put(key, value); });
+    }
+
+    bool get(Key key, Value& value) {
+        return shards_.read(key, value, [&](SliceType& slice, Value& out) { return slice.get(key, out); });
+    }
+
+    Value get(Key key) {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool remove(Key key) { return shards_.remove(key); }
+
+    // 在线调整分片数，见 KHashLruCaches::reshard
+    bool reshard(int sliceNum) { return shards_.reshard(sliceNum); }
+
+    void waitForReshard() { shards_.waitForReshard(); }
+
+    int sliceNum() const { return shards_.sliceNum(); }
+
+    // 调整总容量，见 KReshardableSlices::setCapacity
+    void setCapacity(size_t capacity) { shards_.setCapacity(capacity); }
+
+    // 分片选择改用带种子的哈希，元素在后台重新分布 | 正在调整分片时返回false
+    bool setHashSeed(uint64_t seed = randomSeed()) { return shards_.reseed(seed); }
+
+    void purge() {
+        shards_.removeEverywhere([this](const typename Shards::Route&) {
+            shards_.forEachSlice([](SliceType& slice) { slice.purge(); });
+            return size_t(0);
+        });
+    }
+
+private:
+    Shards shards_;  // 平面合并分片，可在线调整分片数
+};
+
+}  // namespace KamaCache
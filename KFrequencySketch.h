@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace KamaCache {
+
+// 访问频率估计（count-min sketch）：4 行 4 位计数器，每个 64 位原子字存放 16 个计数器，计数与估计都不加锁。
+// 累计记录 sampleSize 次后所有计数器减半，使估计值反映最近的访问频率而不是历史总量。估计值上限为 15
+class KFrequencySketch {
+public:
+    // expectedKeys：需要区分的 key 个数，决定计数器个数
+    explicit KFrequencySketch(size_t expectedKeys) {
+        size_t words = 1;
+        while (words * kCountersPerWord < std::max<size_t>(expectedKeys, 16)) words <<= 1;
+        wordMask_ = words - 1;
+        sampleSize_ = 10 * words * kCountersPerWord;
+        for (auto& row : rows_) {
+            row.reset(new std::atomic<uint64_t>[words]);
+            for (size_t i = 0; i < words; ++i) row[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // 记录一次访问
+    void increment(uint64_t hash) {
+        for (int i = 0; i < kRows; ++i) {
+            uint64_t h = rehash(hash, i);
+            std::atomic<uint64_t>& word = rows_[i][h & wordMask_];
+            int shift = static_cast<int>((h >> 32) % kCountersPerWord) * 4;
+            uint64_t old = word.load(std::memory_order_relaxed);
+            while (((old >> shift) & 0xF) != 0xF &&
+                   !word.compare_exchange_weak(old, old + (1ull << shift), std::memory_order_relaxed)) {
+            }
+        }
+        if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 == sampleSize_) reset();
+    }
+
+    // 估计访问次数：各行计数器的最小值
+    int estimate(uint64_t hash) const {
+        int result = 0xF;
+        for (int i = 0; i < kRows; ++i) {
+            uint64_t h = rehash(hash, i);
+            int shift = static_cast<int>((h >> 32) % kCountersPerWord) * 4;
+            int count = static_cast<int>((rows_[i][h & wordMask_].load(std::memory_order_relaxed) >> shift) & 0xF);
+            result = std::min(result, count);
+        }
+        return result;
+    }
+
+private:
+    static constexpr int kRows = 4;
+    static constexpr size_t kCountersPerWord = 16;
+
+    static uint64_t rehash(uint64_t hash, int row) {
+        uint64_t h = hash + 0x9e3779b97f4a7c15ULL * (row + 1);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // 所有计数器减半：每个 4 位计数器右移一位，清掉从高位计数器移入的位
+    void reset() {
+        for (auto& row : rows_) {
+            for (size_t i = 0; i <= wordMask_; ++i) {
+                uint64_t old = row[i].load(std::memory_order_relaxed);
+                while (!row[i].compare_exchange_weak(old, (old >> 1) & 0x7777777777777777ULL,
+                                                     std::memory_order_relaxed)) {
+                }
+            }
+        }
+        additions_.fetch_sub(sampleSize_ / 2, std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> rows_[kRows];
+    size_t wordMask_;    // 每行的字数减一
+    size_t sampleSize_;  // 减半周期
+    std::atomic<size_t> additions_{0};
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "KICachePolicy.h"
+#include "KLruCache.h"
+
+namespace KamaCache {
+
+// 基于纪元的内存回收：读者计数按线程分散到多个缓存行，每个槽位有奇偶两个计数器（类似用户态 RCU）。
+// 读者进入时只修改自己槽位的计数，不加锁；写者换下旧指针后调用 synchronize，等此前进入的读者全部离开再释放。
+// Mutex 为串行化写者的锁的类型，见 KLock.h
+template <typename Mutex = std::mutex>
+class KEpochDomain {
+public:
+    class Guard {
+    public:
+        explicit Guard(std::atomic<uint64_t>* counter) : counter_(counter) {}
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { counter_->fetch_sub(1, std::memory_order_release); }
+
+    private:
+        std::atomic<uint64_t>* counter_;
+    };
+
+    // 读者进入临界区，Guard 析构时离开
+    Guard enter() {
+        Slot& slot = slots_[slotIndex()];
+        while (true) {
+            uint64_t epoch = epoch_.load();
+            slot.readers[epoch & 1].fetch_add(1);
+            // 计数之前纪元已经翻转的话，写者可能已经检查过这个槽位，需要按新纪元重新登记
+            if (epoch_.load() == epoch) return Guard(&slot.readers[epoch & 1]);
+            slot.readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // 翻转纪元并等待按旧纪元登记的读者全部离开，调用前应已把旧指针换下
+    void synchronize() {
+        std::lock_guard<Mutex> lock(mutex_);
+        uint64_t epoch = epoch_.load();
+        epoch_.store(epoch + 1);
+        for (Slot& slot : slots_) {
+            while (slot.readers[epoch & 1].load(std::memory_order_acquire) != 0) std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr size_t kSlots = 64;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> readers[2] = {{0}, {0}};
+    };
+
+    static size_t slotIndex() {
+        thread_local size_t index = std::hash<std::thread::id>{}(std::this_thread::get_id()) % kSlots;
+        return index;
+    }
+
+    std::atomic<uint64_t> epoch_{0};
+    Slot slots_[kSlots];
+    Mutex mutex_;  // 串行化多个写者
+};
+
+// 构建后只读的热点表：用 CHD/PTHash 式的最小完美哈希定位，n 个元素恰好占 n 个槽位。
+// key 先按哈希分到若干桶，每个桶搜索一个 pilot，使桶内所有 key 落到互不相同的空槽位。
+// 查找时一次哈希、读一个 pilot、比较一个 key；元素被覆盖写入后只会置失效标记，不会修改内容
+template <typename Key, typename Value>
+class KFrozenTable {
+public:
+    // entries 中的 key 不能重复
+    explicit KFrozenTable(const std::vector<std::pair<Key, Value>>& entries) {
+        for (uint64_t attempt = 0; attempt < kMaxAttempts; ++attempt) {
+            seed_ = mix(attempt + 1);
+            if (build(entries)) return;
+        }
+        // 多次换种子都失败（实际上不会发生），退化为空表，所有查询回落到分片缓存
+        pilots_.clear();
+        keys_.clear();
+        values_.clear();
+        slotCount_ = 0;
+    }
+
+    // 查询冻结表，不加锁也不修改任何共享数据 | 不存在或已失效返回false
+    bool find(const Key& key, Value& value) const {
+        if (slotCount_ == 0) return false;
+        size_t pos = slotOf(key);
+        if (!(keys_[pos] == key) || stale_[pos].load(std::memory_order_acquire)) return false;
+        value = values_[pos];
+        return true;
+    }
+
+    // 标记 key 已失效，之后的查询回落到分片缓存
+    void invalidate(const Key& key) {
+        if (slotCount_ == 0) return;
+        size_t pos = slotOf(key);
+        if (keys_[pos] == key) stale_[pos].store(true, std::memory_order_release);
+    }
+
+    size_t size() const { return slotCount_; }
+
+private:
+    static constexpr uint64_t kMaxAttempts = 16;
+    static constexpr uint32_t kMaxPilot = 1u << 24;
+    static constexpr size_t kKeysPerBucket = 2;
+
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    uint64_t hashOf(const Key& key) const { return mix(std::hash<Key>{}(key) ^ seed_); }
+
+    size_t bucketOf(uint64_t hash) const { return (hash >> 32) % pilots_.size(); }
+
+    size_t position(uint64_t hash, uint32_t pilot) const {
+        return mix(hash ^ (seed_ + pilot * 0x9e3779b97f4a7c15ULL)) % slotCount_;
+    }
+
+    size_t slotOf(const Key& key) const {
+        uint64_t hash = hashOf(key);
+        return position(hash, pilots_[bucketOf(hash)]);
+    }
+
+    bool build(const std::vector<std::pair<Key, Value>>& entries) {
+        slotCount_ = entries.size();
+        if (slotCount_ == 0) return true;
+
+        size_t bucketCount = (slotCount_ + kKeysPerBucket - 1) / kKeysPerBucket;
+        pilots_.assign(bucketCount, 0);
+        std::vector<uint64_t> hashes(slotCount_);
+        std::vector<std::vector<size_t>> buckets(bucketCount);
+        for (size_t i = 0; i < slotCount_; ++i) {
+            hashes[i] = hashOf(entries[i].first);
+            buckets[bucketOf(hashes[i])].push_back(i);
+        }
+
+        // 先放元素多的桶，此时空槽位最多，越往后的桶越小、越容易找到位置
+        std::vector<size_t> order(bucketCount);
+        for (size_t i = 0; i < bucketCount; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<bool> taken(slotCount_, false);
+        std::vector<size_t> positions;
+        for (size_t b : order) {
+            const std::vector<size_t>& bucket = buckets[b];
+            if (bucket.empty()) break;
+            uint32_t pilot = 0;
+            for (; pilot < kMaxPilot; ++pilot) {
+                positions.clear();
+                bool ok = true;
+                for (size_t i : bucket) {
+                    size_t pos = position(hashes[i], pilot);
+                    if (taken[pos] || std::find(positions.begin(), positions.end(), pos) != positions.end()) {
+                        ok = false;
+                        break;
+                    }
+                    positions.push_back(pos);
+                }
+                if (ok) break;
+            }
+            if (pilot == kMaxPilot) return false;  // 桶内有哈希完全相同的 key，换种子重试
+            pilots_[b] = pilot;
+            for (size_t pos : positions) taken[pos] = true;
+        }
+
+        keys_.assign(slotCount_, Key());
+        values_.assign(slotCount_, Value());
+        stale_.reset(new std::atomic<bool>[slotCount_]);
+        for (size_t i = 0; i < slotCount_; ++i) {
+            size_t pos = position(hashes[i], pilots_[bucketOf(hashes[i])]);
+            keys_[pos] = entries[i].first;
+            values_[pos] = entries[i].second;
+            stale_[pos].store(false, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+private:
+    uint64_t seed_ = 0;
+    size_t slotCount_ = 0;                         // 槽位数，等于元素个数
+    std::vector<uint32_t> pilots_;                 // 每个桶的 pilot
+    std::vector<Key> keys_;                        // 按槽位存放的 key
+    std::vector<Value> values_;                    // 按槽位存放的 value
+    std::unique_ptr<std::atomic<bool>[]> stale_;   // 失效标记
+};
+
+// 冻结热点集：后台线程定期从分片 LRU 中提取最新的 hotSetSize 个元素，构建只读的完美哈希表并原子替换。
+// 读先查冻结表（不加锁），未命中再查分片缓存；写入和删除会把冻结表中对应的元素标记为失效。
+// Mutex 为分片缓存与写者（重建、失效记录、纪元同步）使用的锁的类型，见 KLock.h；
+// 后台线程等待停止信号的锁与条件变量配合使用，固定为 std::mutex
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KFrozenHotSetCache : public KICachePolicy<Key, Value> {
+public:
+    using TableType = KFrozenTable<Key, Value>;
+    using Epoch = KEpochDomain<Mutex>;
+
+    // refreshInterval 为 0 时不启动后台线程，只在调用 refresh() 时重建
+    KFrozenHotSetCache(size_t capacity, int sliceNum, size_t hotSetSize,
+                       std::chrono::milliseconds refreshInterval = std::chrono::milliseconds(100))
+        : liveCache_(capacity, sliceNum), hotSetSize_(hotSetSize), refreshInterval_(refreshInterval) {
+        if (refreshInterval_.count() > 0) refreshThread_ = std::thread([this] { refreshLoop(); });
+    }
+
+    ~KFrozenHotSetCache() override {
+        {
+            std::lock_guard<std::mutex> lock(stopMutex_);
+            stopping_ = true;
+        }
+        stopCond_.notify_all();
+        if (refreshThread_.joinable()) refreshThread_.join();
+        delete table_.load();
+    }
+
+    void put(Key key, Value value) override {
+        liveCache_.put(key, value);
+        invalidateFrozen(key);
+    }
+
+    bool get(Key key, Value& value) override {
+        bool frozenHit;
+        {
+            typename Epoch::Guard guard = epoch_.enter();
+            const TableType* table = table_.load(std::memory_order_acquire);
+            frozenHit = table && table->find(key, value);
+        }
+        if (!frozenHit) return liveCache_.get(key, value);
+
+        // 冻结表命中不会更新分片中的新旧顺序，热点元素会逐渐被挤出；每个线程每 kTouchSampling 次命中补一次访问
+        thread_local unsigned frozenHits = 0;
+        if ((++frozenHits & (kTouchSampling - 1)) == 0) {
+            Value ignored;
+            liveCache_.get(key, ignored);
+        }
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool remove(Key key) {
+        bool removed = liveCache_.remove(key);
+        invalidateFrozen(key);
+        return removed;
+    }
+
+    // 立即从分片缓存重建冻结表
+    void refresh() {
+        std::lock_guard<Mutex> refreshLock(refreshMutex_);
+        // 重建期间的写入先记录下来，新表发布前统一标记失效，避免新表带着提取时的旧值
+        rebuilding_.store(true);
+        std::vector<std::pair<Key, Value>> entries;
+        entries.reserve(hotSetSize_);
+        liveCache_.collectRecent(hotSetSize_, entries);
+        if (entries.size() > hotSetSize_) entries.resize(hotSetSize_);
+        TableType* table = new TableType(entries);
+
+        TableType* old;
+        {
+            std::lock_guard<Mutex> lock(dirtyMutex_);
+            for (const Key& key : dirtyKeys_) table->invalidate(key);
+            dirtyKeys_.clear();
+            old = table_.exchange(table);
+            rebuilding_.store(false);
+        }
+        epoch_.synchronize();
+        delete old;
+    }
+
+    // 当前冻结表中的元素个数
+    size_t frozenSize() {
+        typename Epoch::Guard guard = epoch_.enter();
+        const TableType* table = table_.load(std::memory_order_acquire);
+        return table ? table->size() : 0;
+    }
+
+private:
+    static constexpr unsigned kTouchSampling = 64;
+
+    void invalidateFrozen(const Key& key) {
+        if (rebuilding_.load()) {
+            std::lock_guard<Mutex> lock(dirtyMutex_);
+            if (rebuilding_.load(std::memory_order_relaxed)) dirtyKeys_.push_back(key);
+        }
+        typename Epoch::Guard guard = epoch_.enter();
+        TableType* table = table_.load(std::memory_order_acquire);
+        if (table) table->invalidate(key);
+    }
+
+    void refreshLoop() {
+        std::unique_lock<std::mutex> lock(stopMutex_);
+        while (!stopCond_.wait_for(lock, refreshInterval_, [this] { return stopping_; })) {
+            lock.unlock();
+            refresh();
+            lock.lock();
+        }
+    }
+
+private:
+    KHashLruCaches<Key, Value, KDefaultAlloc, Mutex> liveCache_;  // 分片缓存，保存全部数据
+    size_t hotSetSize_;                                           // 冻结表的元素个数上限
+    std::chrono::milliseconds refreshInterval_;
+
+    std::atomic<TableType*> table_{nullptr};  // 当前发布的冻结表
+    Epoch epoch_;                             // 旧表的回收
+
+    Mutex refreshMutex_;             // 同一时间只有一个重建
+    std::atomic<bool> rebuilding_{false};
+    Mutex dirtyMutex_;
+    std::vector<Key> dirtyKeys_;     // 重建期间被写入或删除的 key
+
+    std::thread refreshThread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCond_;
+    bool stopping_ = false;
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "KICachePolicy.h"
+#include "KLock.h"
+#include "KReshard.h"
+
+namespace KamaCache {
+
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KGreedyDualCache;
+
+template <typename Key, typename Value>
+class GreedyDualNode {
+private:
+    Key key_;
+    Value value_;
+    double cost_;       // 未命中时重新计算该元素的代价
+    size_t freq_;       // 访问次数
+    double priority_;   // 当前优先级 H = L + freq * cost
+    double heapKey_;    // 在堆中排序所用的优先级，命中时不更新，淘汰时再校正
+    GreedyDualNode* child_ = nullptr;    // 配对堆：第一个孩子
+    GreedyDualNode* sibling_ = nullptr;  // 配对堆：右兄弟
+    GreedyDualNode* prev_ = nullptr;     // 配对堆：左兄弟，最左的孩子指向父结点
+
+public:
+    GreedyDualNode(Key key, Value value, double cost, double priority)
+        : key_(key), value_(value), cost_(cost), freq_(1), priority_(priority), heapKey_(priority) {}
+
+    template <typename K, typename V, typename M>
+    friend class KGreedyDualCache;
+};
+
+// 代价感知缓存（GreedyDual-Size-Frequency，大小视为 1）：每个元素的优先级 H = L + 访问次数 * 代价，
+// 淘汰 H 最小的元素，并把 L 抬高到被淘汰元素的 H，使长期不被访问的高代价元素也会逐渐老化。
+// 优先级索引为配对堆：插入 O(1)，命中只更新结点上的优先级、不调整堆；淘汰时弹出的堆顶若优先级已过期，
+// 则按新的优先级重新插入后继续弹出（优先级只增不减，堆中的旧值总是下界）。目标是最小化未命中代价之和而非未命中次数。
+// Mutex 为锁的类型，见 KLock.h
+template <typename Key, typename Value, typename Mutex>
+class KGreedyDualCache : public KICachePolicy<Key, Value> {
+public:
+    using NodeType = GreedyDualNode<Key, Value>;
+    using NodeMap = std::unordered_map<Key, std::unique_ptr<NodeType>>;
+
+    KGreedyDualCache(int capacity) : capacity_(capacity) {}
+
+    ~KGreedyDualCache() override = default;
+
+    // 不指定代价时代价为 1，等价于 LFU 与 LRU 的折中
+    void put(Key key, Value value) override { put(key, value, 1.0); }
+
+    // 写入元素并指定其未命中代价（例如重新计算所需的毫秒数）
+    void put(Key key, Value value, double cost) {
+        if (capacity_ <= 0) return;
+
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end()) {
+            NodeType* node = it->second.get();
+            node->value_ = value;
+            node->cost_ = cost;
+            hit(node);
+            return;
+        }
+
+        if (capacity_ <= 0) return;  // 加锁前检查之后容量可能被 setCapacity 改为 0
+        if (nodeMap_.size() >= static_cast<size_t>(capacity_)) evict();
+        auto node = std::make_unique<NodeType>(key, value, cost, inflation_ + cost);
+        root_ = meld(root_, node.get());
+        nodeMap_[key] = std::move(node);
+    }
+
+    bool get(Key key, Value& value) override {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) return false;
+        hit(it->second.get());
+        value = it->second->value_;
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) return false;
+        erase(it->second.get());
+        nodeMap_.erase(it);
+        return true;
+    }
+
+    void purge() {
+        std::lock_guard<Mutex> lock(mutex_);
+        root_ = nullptr;
+        nodeMap_.clear();
+        inflation_ = 0;
+    }
+
+    // 不存在时以代价 1 写入，用于迁入已经在其他缓存中的元素 | key 已存在时不覆盖并返回false
+    bool putIfAbsent(Key key, Value value) {
+        if (capacity_ <= 0) return false;
+
+        std::lock_guard<Mutex> lock(mutex_);
+        if (capacity_ <= 0 || nodeMap_.find(key) != nodeMap_.end()) return false;
+        if (nodeMap_.size() >= static_cast<size_t>(capacity_)) evict();
+        auto node = std::make_unique<NodeType>(key, std::move(value), 1.0, inflation_ + 1.0);
+        root_ = meld(root_, node.get());
+        nodeMap_[key] = std::move(node);
+        return true;
+    }
+
+    // 一次加锁取出 keys[0..count) 中存在的元素：从缓存中删除，并把 key 与 value 追加到 out | 返回取出的个数
+    size_t extract(const Key* keys, size_t count, std::vector<std::pair<Key, Value>>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t extracted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto it = nodeMap_.find(keys[i]);
+            if (it == nodeMap_.end()) continue;
+            erase(it->second.get());
+            out.emplace_back(it->first, std::move(it->second->value_));
+            nodeMap_.erase(it);
+            ++extracted;
+        }
+        return extracted;
+    }
+
+    // 复制所有 key 追加到 out
+    void collectKeys(std::vector<Key>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        out.reserve(out.size() + nodeMap_.size());
+        for (auto& entry : nodeMap_) out.push_back(entry.first);
+    }
+
+    // 调整容量，超出新容量的元素按优先级从低到高移除
+    void setCapacity(int capacity) {
+        std::lock_guard<Mutex> lock(mutex_);
+        capacity_ = capacity;
+        while (!nodeMap_.empty() && nodeMap_.size() > static_cast<size_t>(std::max(capacity, 0))) evict();
+    }
+
+    int capacity() const { return capacity_; }
+
+private:
+    void hit(NodeType* node) {
+        ++node->freq_;
+        node->priority_ = inflation_ + node->freq_ * node->cost_;
+        // 写入时代价可能变小，优先级降低后堆中的旧值不再是下界，需要立即重新排序
+        if (node->priority_ < node->heapKey_) {
+            erase(node);
+            node->heapKey_ = node->priority_;
+            root_ = meld(root_, node);
+        }
+    }
+
+    void evict() {
+        while (root_) {
+            NodeType* min = root_;
+            root_ = mergePairs(min->child_);
+            min->child_ = nullptr;
+            if (min->heapKey_ < min->priority_) {
+                // 命中后没有更新堆，按当前优先级重新插入
+                min->heapKey_ = min->priority_;
+                root_ = meld(root_, min);
+                continue;
+            }
+            inflation_ = min->priority_;
+            nodeMap_.erase(nodeMap_.find(min->key_));  // 按迭代器删除：min->key_ 随结点一起析构
+            return;
+        }
+    }
+
+    // 从堆中摘下任意结点
+    void erase(NodeType* node) {
+        if (node == root_) {
+            root_ = mergePairs(node->child_);
+            node->child_ = nullptr;
+            return;
+        }
+        if (node->prev_->child_ == node) {
+            node->prev_->child_ = node->sibling_;
+        } else {
+            node->prev_->sibling_ = node->sibling_;
+        }
+        if (node->sibling_) node->sibling_->prev_ = node->prev_;
+        node->sibling_ = nullptr;
+        node->prev_ = nullptr;
+        NodeType* subtree = mergePairs(node->child_);
+        node->child_ = nullptr;
+        root_ = meld(root_, subtree);
+    }
+
+    // 合并两个堆，a、b 都必须是独立的根结点
+    static NodeType* meld(NodeType* a, NodeType* b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (b->heapKey_ < a->heapKey_) std::swap(a, b);
+        b->prev_ = a;
+        b->sibling_ = a->child_;
+        if (a->child_) a->child_->prev_ = b;
+        a->child_ = b;
+        a->sibling_ = nullptr;
+        a->prev_ = nullptr;
+        return a;
+    }
+
+    // 两趟合并兄弟链表：从左到右两两合并，再从右到左依次合并
+    NodeType* mergePairs(NodeType* first) {
+        if (!first) return nullptr;
+        pairs_.clear();
+        while (first) {
+            NodeType* a = first;
+            NodeType* b = a->sibling_;
+            first = b ? b->sibling_ : nullptr;
+            a->sibling_ = a->prev_ = nullptr;
+            if (b) b->sibling_ = b->prev_ = nullptr;
+            pairs_.push_back(meld(a, b));
+        }
+        NodeType* root = pairs_.back();
+        for (size_t i = pairs_.size() - 1; i-- > 0;) root = meld(pairs_[i], root);
+        return root;
+    }
+
+private:
+    std::atomic<int> capacity_;     // 缓存容量，可由 setCapacity 调整
+    double inflation_ = 0;          // 老化值 L：最近一次被淘汰元素的优先级
+    NodeType* root_ = nullptr;      // 配对堆的根，优先级最小
+    NodeMap nodeMap_;               // key 到结点的映射，结点由这里持有
+    std::vector<NodeType*> pairs_;  // mergePairs 的临时空间
+    Mutex mutex_;                   // 互斥锁
+};
+
+// 代价感知缓存的分片版本，分片由 KReshardableSlices 管理，可在线调整分片数与分片哈希种子。
+// 迁移到新分片的元素代价重置为 1、访问次数从 1 重新开始
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KHashGreedyDualCache {
+public:
+    using SliceType = KGreedyDualCache<Key, Value, Mutex>;
+    using Shards = KReshardableSlices<Key, Value, SliceType>;
+
+    KHashGreedyDualCache(size_t capacity, int sliceNum)
+        : shards_(capacity, sliceNum, [](int, size_t sliceSize) { return new SliceType(sliceSize); }) {}
+
+    void put(Key key, Value value) { put(key, value, 1.0); }
+
+    void put(Key key, Value value, double cost) {
+        shards_.write(key, [&](SliceType& slice) { slice.put(key, value, cost); });
+    }
+
+    bool get(Key key, Value& value) {
+        return shards_.read(key, value, [&](SliceType& slice, Value& out) { return slice.get(key, out); });
+    }
+
+    Value get(Key key) {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool remove(Key key) { return shards_.remove(key); }
+
+    // 在线调整分片数，见 KHashLruCaches::reshard
+    bool reshard(int sliceNum) { return shards_.reshard(sliceNum); }
+
+    void waitForReshard() { shards_.waitForReshard(); }
+
+    int sliceNum() const { return shards_.sliceNum(); }
+
+    // 调整总容量，见 KReshardableSlices::setCapacity
+    void setCapacity(size_t capacity) { shards_.setCapacity(capacity); }
+
+    // 分片选择改用带种子的哈希，元素在后台重新分布 | 正在调整分片时返回false
+    bool setHashSeed(uint64_t seed = randomSeed()) { return shards_.reseed(seed); }
+
+    void purge() {
+        shards_.removeEverywhere([this](const typename Shards::Route&) {
+            shards_.forEachSlice([](SliceType& slice) { slice.purge(); });
+            return size_t(0);
+        });
+    }
+
+private:
+    Shards shards_;  // 代价感知分片，可在线调整分片数
+};
+
+}  // namespace KamaCache
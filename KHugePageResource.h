@@ -0,0 +1,160 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace KamaCache {
+
+// 以 2MB 大页为单位向内核申请内存的 memory_resource，用于千万级元素的缓存：结点与哈希桶数组集中在少量大页上，
+// 哈希探测与链表调整跨越的页数大幅减少，降低 dTLB 未命中。申请顺序为：
+//   1. MAP_HUGETLB（需要预留 /proc/sys/vm/nr_hugepages）
+//   2. 失败时按 2MB 对齐映射普通内存并 madvise(MADV_HUGEPAGE)，由透明大页合并
+//   3. 关闭大页（useHugePages = false）时 madvise(MADV_NOHUGEPAGE)，用于对比
+// 不超过 kMaxSmallSize 的内存（结点、控制块）按 16 字节分级，从当前 2MB 区块中顺序切出，释放后挂到同级的空闲链表复用；
+// 不小于半个大页的内存（扩容后的哈希桶数组）单独映射，释放时立即归还；其余大小的内存只在析构时释放。
+// 不是线程安全的，分片缓存每个分片各用一个，由分片锁保证串行访问。必须比使用它的缓存活得更久
+class KHugePageResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kHugePageSize = 2u << 20;
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxSmallSize = 512;
+
+    explicit KHugePageResource(bool useHugePages = true) : useHugePages_(useHugePages) {}
+
+    ~KHugePageResource() override {
+        for (auto& chunk : chunks_) unmap(chunk.first, chunk.second);
+        for (auto& mapping : large_) unmap(mapping.first, mapping.second);
+    }
+
+    KHugePageResource(const KHugePageResource&) = delete;
+    KHugePageResource& operator=(const KHugePageResource&) = delete;
+
+    size_t mappedBytes() const { return mappedBytes_; }    // 当前映射的字节数
+    size_t hugeTlbBytes() const { return hugeTlbBytes_; }  // 其中来自 MAP_HUGETLB 的字节数
+    size_t advisedBytes() const { return advisedBytes_; }  // 其中 madvise 为透明大页的字节数
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Mapping {
+        size_t length;
+        bool hugeTlb;  // 来自 MAP_HUGETLB
+        bool advised;  // 已 madvise 为透明大页
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (bytes >= kHugePageSize / 2) {
+            Mapping mapping{roundUp(bytes, kHugePageSize), false, false};
+            void* p = map(mapping);
+            large_[p] = mapping;
+            return p;
+        }
+        if (bytes <= kMaxSmallSize && alignment <= kGranularity) {
+            size_t sizeClass = (std::max(bytes, size_t(1)) - 1) / kGranularity;
+            if (FreeBlock* block = freeLists_[sizeClass]) {
+                freeLists_[sizeClass] = block->next;
+                return block;
+            }
+            return carve((sizeClass + 1) * kGranularity, kGranularity);
+        }
+        return carve(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        if (bytes >= kHugePageSize / 2) {
+            auto it = large_.find(p);
+            unmap(it->first, it->second);
+            large_.erase(it);
+        } else if (bytes <= kMaxSmallSize && alignment <= kGranularity) {
+            size_t sizeClass = (std::max(bytes, size_t(1)) - 1) / kGranularity;
+            FreeBlock* block = static_cast<FreeBlock*>(p);
+            block->next = freeLists_[sizeClass];
+            freeLists_[sizeClass] = block;
+        }
+        // 其余大小的内存（较小的哈希桶数组等）随区块在析构时释放
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    // 从当前区块顺序切出一块内存，区块用完时映射新的区块
+    void* carve(size_t bytes, size_t alignment) {
+        uintptr_t start = roundUp(cursor_, alignment);
+        if (cursor_ == 0 || start + bytes > chunkEnd_) {
+            Mapping mapping{kHugePageSize, false, false};
+            void* chunk = map(mapping);
+            chunks_.emplace_back(chunk, mapping);
+            cursor_ = reinterpret_cast<uintptr_t>(chunk);
+            chunkEnd_ = cursor_ + kHugePageSize;
+            start = roundUp(cursor_, alignment);
+        }
+        cursor_ = start + bytes;
+        return reinterpret_cast<void*>(start);
+    }
+
+    // 映射 mapping.length 字节（2MB 的整数倍），起始地址按 2MB 对齐
+    void* map(Mapping& mapping) {
+        size_t length = mapping.length;
+        void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (useHugePages_ && hugeTlbAvailable_) {
+            p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                mapping.hugeTlb = true;
+                mappedBytes_ += length;
+                hugeTlbBytes_ += length;
+                return p;
+            }
+            hugeTlbAvailable_ = false;  // 没有预留大页，之后不再尝试
+        }
+#endif
+        // 多映射一个大页，裁掉首尾使起始地址对齐，透明大页才能覆盖整个区间
+        size_t padded = length + kHugePageSize;
+        p = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        uintptr_t raw = reinterpret_cast<uintptr_t>(p);
+        uintptr_t aligned = roundUp(raw, kHugePageSize);
+        if (aligned > raw) ::munmap(p, aligned - raw);
+        ::munmap(reinterpret_cast<void*>(aligned + length), raw + padded - aligned - length);
+        p = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+        if (::madvise(p, length, useHugePages_ ? MADV_HUGEPAGE : MADV_NOHUGEPAGE) == 0 && useHugePages_) {
+            mapping.advised = true;
+            advisedBytes_ += length;
+        }
+#endif
+        mappedBytes_ += length;
+        return p;
+    }
+
+    void unmap(void* p, const Mapping& mapping) {
+        ::munmap(p, mapping.length);
+        mappedBytes_ -= mapping.length;
+        if (mapping.hugeTlb) hugeTlbBytes_ -= mapping.length;
+        if (mapping.advised) advisedBytes_ -= mapping.length;
+    }
+
+    static uintptr_t roundUp(uintptr_t n, size_t alignment) { return (n + alignment - 1) & ~(uintptr_t(alignment) - 1); }
+
+private:
+    bool useHugePages_;
+    bool hugeTlbAvailable_ = true;
+    uintptr_t cursor_ = 0;                                       // 当前区块中下一块可用内存的地址
+    uintptr_t chunkEnd_ = 0;                                     // 当前区块的结束地址
+    FreeBlock* freeLists_[kMaxSmallSize / kGranularity] = {};   // 按 16 字节分级的空闲链表
+    std::vector<std::pair<void*, Mapping>> chunks_;              // 切分小块内存的 2MB 区块
+    std::unordered_map<void*, Mapping> large_;                   // 单独映射的大块内存
+    size_t mappedBytes_ = 0;
+    size_t hugeTlbBytes_ = 0;
+    size_t advisedBytes_ = 0;
+};
+
+}  // namespace KamaCache
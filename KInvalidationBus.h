@@ -0,0 +1,242 @@
+#pragma once
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace KamaCache {
+
+// 跨进程的近端缓存失效通道：位于 POSIX 共享内存中的广播环形队列，元素是失效 key 的哈希值。
+// 发布者持有进程间共享的 robust 锁批量写入，订阅者无需注册，各自维护读取位置轮询即可（空闲时只有一次原子读）。
+// 订阅者落后超过环的容量时无法知道丢失了哪些 key，poll 会报告溢出，调用方应清空整个近端缓存。
+// 哈希值由发布者算出、订阅者直接比较，双方必须使用同一个哈希函数：KLruCache::keyHash 基于 std::hash，
+// 只在运行同一份程序（同一个标准库实现）的进程之间一致
+class KInvalidationBus {
+public:
+    // 打开名为 name 的失效通道，不存在时以 capacity 个槽位创建
+    explicit KInvalidationBus(const std::string& name, size_t capacity = 64 * 1024) : name_(name) {
+        if (capacity == 0) throw std::invalid_argument("KInvalidationBus capacity must be positive");
+        attach(capacity);
+    }
+
+    ~KInvalidationBus() {
+        if (header_ != nullptr) ::munmap(header_, mappedBytes_);
+    }
+
+    KInvalidationBus(const KInvalidationBus&) = delete;
+    KInvalidationBus& operator=(const KInvalidationBus&) = delete;
+
+    static void unlink(const std::string& name) { ::shm_unlink(name.c_str()); }
+
+    size_t capacity() const { return header_->capacity; }
+
+    // 当前已发布的总条数，新订阅者从这里开始读取
+    uint64_t writeSequence() const { return header_->writeSeq.load(std::memory_order_acquire); }
+
+    // 发布一批失效的 key 哈希，整批在一次加锁内写入
+    void publish(const uint64_t* hashes, size_t count) {
+        if (count == 0) return;
+        lock();
+        uint64_t seq = header_->writeSeq.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i, ++seq) {
+            Entry& entry = entries()[seq % header_->capacity];
+            // 每个槽位是一个小的 seqlock：先作废序号，再写哈希，最后写入新的序号（+1 使 0 表示无效）
+            entry.seq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            entry.hash.store(hashes[i], std::memory_order_relaxed);
+            entry.seq.store(seq + 1, std::memory_order_release);
+        }
+        header_->writeSeq.store(seq, std::memory_order_release);
+        pthread_mutex_unlock(&header_->mutex);
+    }
+
+    // 读取 [cursor, writeSequence) 之间的哈希追加到 out，并推进 cursor。
+    // 这段数据已被新数据覆盖（订阅者落后太多）时返回false，cursor 跳到最新位置，out 中的内容不完整
+    bool read(uint64_t& cursor, std::vector<uint64_t>& out) const {
+        uint64_t end = header_->writeSeq.load(std::memory_order_acquire);
+        if (end - cursor > header_->capacity) {
+            cursor = end;
+            return false;
+        }
+        for (; cursor < end; ++cursor) {
+            const Entry& entry = entries()[cursor % header_->capacity];
+            uint64_t before = entry.seq.load(std::memory_order_acquire);
+            uint64_t hash = entry.hash.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t after = entry.seq.load(std::memory_order_relaxed);
+            if (before != cursor + 1 || after != cursor + 1) {
+                cursor = header_->writeSeq.load(std::memory_order_acquire);
+                return false;
+            }
+            out.push_back(hash);
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint64_t kMagic = 0x4b494e56414c4944ull;  // "KINVALID"
+
+    struct Header {
+        uint64_t magic = 0;
+        std::atomic<uint32_t> ready{0};
+        uint64_t capacity = 0;
+        pthread_mutex_t mutex;  // 发布者之间互斥
+        alignas(64) std::atomic<uint64_t> writeSeq{0};
+    };
+
+    struct Entry {
+        std::atomic<uint64_t> seq{0};  // 写入该槽位的序号 +1，0 表示正在写入
+        std::atomic<uint64_t> hash{0};
+    };
+
+    static size_t entriesOffset() { return (sizeof(Header) + 63) / 64 * 64; }
+
+    Entry* entries() const { return reinterpret_cast<Entry*>(reinterpret_cast<char*>(header_) + entriesOffset()); }
+
+    void lock() {
+        int rc = pthread_mutex_lock(&header_->mutex);
+#ifdef __linux__
+        // 上一个发布者在写入途中退出：writeSeq 尚未推进，残留的半批数据会被下一批覆盖
+        if (rc == EOWNERDEAD) rc = pthread_mutex_consistent(&header_->mutex);
+#endif
+        if (rc != 0) throw std::runtime_error("KInvalidationBus lock failed: " + std::string(std::strerror(rc)));
+    }
+
+    void attach(size_t capacity) {
+        size_t totalBytes = entriesOffset() + capacity * sizeof(Entry);
+        bool creator = true;
+        int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            creator = false;
+            fd = ::shm_open(name_.c_str(), O_RDWR, 0600);
+        }
+        if (fd < 0) throw std::runtime_error("shm_open " + name_ + ": " + std::strerror(errno));
+
+        if (creator && ::ftruncate(fd, static_cast<off_t>(totalBytes)) < 0) {
+            int err = errno;
+            ::close(fd);
+            ::shm_unlink(name_.c_str());
+            throw std::runtime_error("ftruncate " + name_ + ": " + std::strerror(err));
+        }
+        if (!creator) {
+            // 等创建者 ftruncate 完成后，以实际大小为准映射
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            struct stat st {};
+            while (::fstat(fd, &st) == 0 && st.st_size == 0 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            totalBytes = static_cast<size_t>(st.st_size);
+            if (totalBytes < entriesOffset()) {
+                ::close(fd);
+                throw std::runtime_error("KInvalidationBus " + name_ + " was never initialized");
+            }
+        }
+
+        void* addr = ::mmap(nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) throw std::runtime_error("mmap " + name_ + ": " + std::strerror(errno));
+        mappedBytes_ = totalBytes;
+
+        if (creator) {
+            header_ = ::new (addr) Header;
+            header_->magic = kMagic;
+            header_->capacity = capacity;
+            for (size_t i = 0; i < capacity; ++i) ::new (static_cast<void*>(entries() + i)) Entry;
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+            pthread_mutex_init(&header_->mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+            header_->ready.store(1, std::memory_order_release);
+            return;
+        }
+
+        header_ = reinterpret_cast<Header*>(addr);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (header_->ready.load(std::memory_order_acquire) == 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("KInvalidationBus " + name_ + " was never initialized");
+            }
+            std::this_thread::yield();
+        }
+        if (header_->magic != kMagic || entriesOffset() + header_->capacity * sizeof(Entry) != totalBytes) {
+            throw std::runtime_error("KInvalidationBus " + name_ + " is corrupted");
+        }
+    }
+
+private:
+    std::string name_;
+    Header* header_ = nullptr;
+    size_t mappedBytes_ = 0;
+};
+
+// 发布端：在本地攒批，达到 batchSize 或显式 flush 时整批发布
+class KInvalidationPublisher {
+public:
+    explicit KInvalidationPublisher(KInvalidationBus& bus, size_t batchSize = 256) : bus_(bus), batchSize_(batchSize) {}
+
+    ~KInvalidationPublisher() { flush(); }
+
+    // 记录一个失效的 key 哈希（如 KLruCache::keyHash(key)）
+    void invalidate(uint64_t hash) {
+        pending_.push_back(hash);
+        if (pending_.size() >= batchSize_) flush();
+    }
+
+    void flush() {
+        bus_.publish(pending_.data(), pending_.size());
+        pending_.clear();
+    }
+
+private:
+    KInvalidationBus& bus_;
+    size_t batchSize_;
+    std::vector<uint64_t> pending_;
+};
+
+// 订阅端：把新到达的失效通知应用到近端缓存。Cache 需要提供 invalidateHashes 与 purge（如开启了哈希索引的 KLruCache、KHashLruCaches）
+class KInvalidationSubscriber {
+public:
+    // 从当前位置开始订阅，之前发布的通知不会被应用
+    explicit KInvalidationSubscriber(const KInvalidationBus& bus) : bus_(bus), cursor_(bus.writeSequence()) {}
+
+    // 读取并应用所有新通知，每个分片只加一次锁；落后太多丢失了通知时清空整个缓存 | 返回读取到的通知条数
+    template <typename Cache>
+    size_t poll(Cache& cache) {
+        batch_.clear();
+        if (!bus_.read(cursor_, batch_)) {
+            cache.purge();
+            ++overflows_;
+            return batch_.size();
+        }
+        if (!batch_.empty()) cache.invalidateHashes(batch_.data(), batch_.size());
+        return batch_.size();
+    }
+
+    // 因落后太多而清空缓存的次数
+    uint64_t overflows() const { return overflows_; }
+
+private:
+    const KInvalidationBus& bus_;
+    uint64_t cursor_;
+    uint64_t overflows_ = 0;
+    std::vector<uint64_t> batch_;
+};
+
+}  // namespace KamaCache
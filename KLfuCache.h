@@ -1,20 +1,31 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "KAdmissionFilter.h"
+#include "KAllocator.h"
+#include "KCacheBudget.h"
+#include "KDeferredRelease.h"
 #include "KICachePolicy.h"
+#include "KLock.h"
+#include "KReshard.h"
+#include "KSeededHash.h"
 
 namespace KamaCache {
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class KLfuCache;
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc>
 class FreqList {
 private:
     struct Node {
@@ -26,7 +37,7 @@ private:
 
         Node() : freq(1), pre(nullptr), next(nullptr) {}
 
-        Node(Key key, Value value) : freq(1), key(key), value(value), pre(nullptr), next(nullptr) {}
+        Node(Key key, Value value) : freq(1), key(key), value(std::move(value)), pre(nullptr), next(nullptr) {}
     };
 
     using NodePtr = std::shared_ptr<Node>;
@@ -35,13 +46,24 @@ private:
     NodePtr tail_;  // 假尾结点
 
 public:
-    explicit FreqList(int n) : freq_(n) {
-        head_ = std::make_shared<Node>();
-        tail_ = std::make_shared<Node>();
+    explicit FreqList(int n, const Alloc& alloc = Alloc()) : freq_(n) {
+        head_ = std::allocate_shared<Node>(alloc);
+        tail_ = std::allocate_shared<Node>(alloc);
         head_->next = tail_;
         tail_->pre = head_;
     }
 
+    // 结点之间用 shared_ptr 双向相连，析构时断开链表避免循环引用
+    ~FreqList() {
+        NodePtr node = head_;
+        while (node) {
+            NodePtr next = node->next;
+            node->pre = nullptr;
+            node->next = nullptr;
+            node = next;
+        }
+    }
+
     bool isEmpty() const { return head_->next == tail_; }
 
     // 提那家结点管理方法
@@ -66,47 +88,64 @@ public:
 
     NodePtr getFirstNode() const { return head_->next; }
 
-    friend class KLfuCache<Key, Value>;
+    template <typename K, typename V, typename A, typename M>
+    friend class KLfuCache;
     // friend class KArcCache<Key, Value>;
 };
 
-template <typename Key, typename Value>
+// Alloc 用于结点、频次链表与哈希表的内存分配，见 KAllocator.h；Mutex 为分片锁的类型，见 KLock.h
+template <typename Key, typename Value, typename Alloc, typename Mutex>
 class KLfuCache : public KICachePolicy<Key, Value> {
 public:
-    using Node = typename FreqList<Key, Value>::Node;
+    using FreqListType = FreqList<Key, Value, Alloc>;
+    using Node = typename FreqListType::Node;
     using NodePtr = std::shared_ptr<Node>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
-
-    KLfuCache(int capacity, int maxAverageNum = 10)
-        : capacity_(capacity), minFreq_(INT8_MAX), maxAverageNum_(maxAverageNum), curAverageNum_(0), curTotalNum_(0) {}
-
-    ~KLfuCache() override = default;
+    using NodeMap = KUnorderedMap<Key, NodePtr, Alloc, KSeededHash<Key>>;  // 默认不带种子，见 setHashSeed
+    using allocator_type = Alloc;
+    using EntryBytes = typename KBudgetMeter<Key, Value>::EntryBytes;
+
+    KLfuCache(int capacity, int maxAverageNum = 10, const Alloc& alloc = Alloc())
+        : capacity_(capacity),
+          minFreq_(INT8_MAX),
+          maxAverageNum_(maxAverageNum),
+          curAverageNum_(0),
+          curTotalNum_(0),
+          nodeMap_(typename NodeMap::allocator_type(alloc)),
+          freqToFreqList_(typename FreqListMap::allocator_type(alloc)),
+          alloc_(alloc),
+          meter_(kNodeBytes) {}
+
+    // 先退出内存预算，之后预算不会再回调本缓存
+    ~KLfuCache() override { setMemoryBudget(nullptr); }
 
     void put(Key key, Value value) override {
-        if (capacity_ == 0) return;
+        if (capacity_ <= 0) return;
 
-        std::lock_guard<std::mutex> lock(mutex_);
+        KDeferredRebalance pending;        // 超出内存预算时在解锁后回收
+        KDeferredRelease<Value> released;  // 被覆盖或淘汰的 value 在解锁后析构
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = nodeMap_.find(key);
         if (it != nodeMap_.end()) {
             // 重置其value值
-            it->second->value = value;
+            assignValue(it->second, std::move(value), released);
             // 找到了直接调整就好了，不用再去get中再找一遍，但其实影响不大
-            getInternal(it->second, value);
-            return;
+            increaseFreq(it->second);
+        } else {
+            putInternal(key, std::move(value), released);
         }
-
-        putInternal(key, value);
+        meter_.check(pending);
     }
 
     // value值为传出参数
     bool get(Key key, Value& value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = nodeMap_.find(key);
         if (it != nodeMap_.end()) {
             getInternal(it->second, value);
             return true;
         }
 
+        meter_.missed(key);
         return false;
     }
 
@@ -116,17 +155,215 @@ public:
         return value;
     }
 
+    // 批量查询：一次加锁查找 keys[indices[0..count)]（indices 为空时依次为 0..count-1），
+    // 命中时写入相同下标的 values 并置 found | 返回命中数。withPrefetch 见 KLruCache::getBatch
+    size_t getBatch(const Key* keys, const size_t* indices, size_t count, Value* values, bool* found,
+                    bool withPrefetch = true) {
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t hits = 0;
+        typename NodeMap::iterator its[kPrefetchGroup];
+        // 分组预取，见 KLruCache::getBatch
+        for (size_t base = 0; base < count; base += kPrefetchGroup) {
+            size_t n = std::min(kPrefetchGroup, count - base);
+            for (size_t i = 0; i < n; ++i) {
+                its[i] = nodeMap_.find(keys[indices ? indices[base + i] : base + i]);
+                if (withPrefetch && its[i] != nodeMap_.end()) prefetch(its[i]->second.get());
+            }
+            for (size_t i = 0; i < n; ++i) {
+                size_t k = indices ? indices[base + i] : base + i;
+                found[k] = its[i] != nodeMap_.end();
+                if (found[k]) {
+                    getInternal(its[i]->second, values[k]);
+                    ++hits;
+                } else {
+                    meter_.missed(keys[k]);
+                }
+            }
+        }
+        return hits;
+    }
+
+    // 批量写入：一次加锁按顺序写入 keys/values[indices[0..count)]（indices 为空时依次为 0..count-1）
+    void putBatch(const Key* keys, const Value* values, const size_t* indices, size_t count) {
+        if (capacity_ <= 0) return;
+
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            size_t k = indices ? indices[i] : i;
+            auto it = nodeMap_.find(keys[k]);
+            if (it != nodeMap_.end()) {
+                assignValue(it->second, values[k], released);
+                increaseFreq(it->second);
+            } else {
+                putInternal(keys[k], values[k], released);
+            }
+        }
+        meter_.check(pending);
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) return false;
+
+        NodePtr node = it->second;
+        meter_.erased(node->key, node->value);
+        released.add(node->value);
+        removeFromFreqList(node);
+        nodeMap_.erase(it);
+        decreaseFreqNum(node->freq);
+        // 删除的可能是最小访问频次链表中的最后一个结点
+        if (node->freq == minFreq_ && freqToFreqList_[minFreq_]->isEmpty()) updateMinFreq();
+        return true;
+    }
+
+    // 不存在时以访问频次 1 写入，用于迁入已经在其他缓存中的元素：不经过准入过滤器 | key 已存在时不覆盖并返回false
+    bool putIfAbsent(Key key, Value value) {
+        if (capacity_ <= 0) return false;
+
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        if (capacity_ <= 0 || nodeMap_.find(key) != nodeMap_.end()) return false;
+        if (nodeMap_.size() >= capacity_) kickOut(released);
+        NodePtr node = std::allocate_shared<Node>(alloc_, key, std::move(value));
+        nodeMap_[key] = node;
+        addToFreqList(node);
+        addFreqNum();
+        minFreq_ = std::min(minFreq_, 1);
+        meter_.inserted(node->key, node->value);
+        meter_.check(pending);
+        return true;
+    }
+
+    // 一次加锁取出 keys[0..count) 中存在的元素：从缓存中删除，并把 key 与 value 追加到 out | 返回取出的个数
+    size_t extract(const Key* keys, size_t count, std::vector<std::pair<Key, Value>>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t extracted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto it = nodeMap_.find(keys[i]);
+            if (it == nodeMap_.end()) continue;
+            NodePtr node = it->second;
+            meter_.erased(node->key, node->value);
+            out.emplace_back(node->key, std::move(node->value));
+            removeFromFreqList(node);
+            nodeMap_.erase(it);
+            decreaseFreqNum(node->freq);
+            if (node->freq == minFreq_ && freqToFreqList_[minFreq_]->isEmpty()) updateMinFreq();
+            ++extracted;
+        }
+        return extracted;
+    }
+
+    // 复制所有 key 追加到 out
+    void collectKeys(std::vector<Key>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        out.reserve(out.size() + nodeMap_.size());
+        for (auto& entry : nodeMap_) out.push_back(entry.first);
+    }
+
+    // 调整容量，超出新容量的元素按淘汰顺序移除
+    void setCapacity(int capacity) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        capacity_ = capacity;
+        while (!nodeMap_.empty() && nodeMap_.size() > static_cast<size_t>(std::max(capacity, 0))) {
+            kickOutInOrder(released);
+        }
+    }
+
+    int capacity() const { return capacity_; }
+
+    // 用带种子的哈希函数重建 key 到结点的哈希表（种子为 0 时恢复 std::hash），防止构造的 key 集中到少数哈希桶。
+    // 需要在锁内重新插入所有元素，适合在开始使用缓存前或低峰期调用
+    void setHashSeed(uint64_t seed) {
+        std::lock_guard<Mutex> lock(mutex_);
+        NodeMap rebuilt(nodeMap_.begin(), nodeMap_.end(), nodeMap_.bucket_count(), KSeededHash<Key>(seed),
+                        std::equal_to<Key>(), nodeMap_.get_allocator());
+        nodeMap_.swap(rebuilt);
+    }
+
+    // 设置准入过滤器（可与其他缓存共享），缓存已满时新 key 需要通过过滤器才会淘汰旧元素并进入缓存；传入空指针关闭
+    void setAdmissionFilter(std::shared_ptr<KBloomAdmissionFilter> filter) {
+        std::lock_guard<Mutex> lock(mutex_);
+        admissionFilter_ = std::move(filter);
+    }
+
+    // 加入全局内存预算，见 KLruCache::setMemoryBudget
+    void setMemoryBudget(std::shared_ptr<KCacheBudget> budget, std::string name = "", EntryBytes entryBytes = nullptr) {
+        std::unique_ptr<KCacheBudget::Account> account;
+        if (budget) account = budget->join(std::move(name), [this](size_t bytes) { return evictForBudget(bytes); });
+        KDeferredRebalance pending;
+        std::lock_guard<Mutex> lock(mutex_);
+        account = meter_.setAccount(std::move(account), std::move(entryBytes));
+        for (auto& entry : nodeMap_) meter_.inserted(entry.first, entry.second->value);
+        meter_.check(pending);
+    }
+
     // 清空缓存,回收资源
     void purge() {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        for (auto& entry : nodeMap_) {
+            meter_.erased(entry.first, entry.second->value);
+            released.add(entry.second->value);
+        }
         nodeMap_.clear();
         freqToFreqList_.clear();
+        minFreq_ = INT8_MAX;
+        curAverageNum_ = 0;
+        curTotalNum_ = 0;
     }
 
 private:
-    void putInternal(Key key, Value value);        // 添加缓存
-    void getInternal(NodePtr node, Value& value);  // 获取缓存
+    static constexpr size_t kPrefetchGroup = 16;  // 批量查询中同时在途的 key 个数
+    // 每个元素固定的内存开销：结点与 shared_ptr 控制块、哈希表结点与桶
+    static constexpr size_t kNodeBytes = sizeof(Node) + sizeof(typename NodeMap::value_type) + 4 * sizeof(void*);
+
+    static void prefetch(const void* address) {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // 覆盖 value，旧值交给 released 在解锁后析构
+    void assignValue(const NodePtr& node, Value value, KDeferredRelease<Value>& released) {
+        meter_.erased(node->key, node->value);
+        released.add(node->value);
+        node->value = std::move(value);
+        meter_.inserted(node->key, node->value);
+    }
+
+    // 连续淘汰时使用：kickOut 不维护最小访问频次，链表变空时需要更新 | 返回释放的字节数
+    size_t kickOutInOrder(KDeferredRelease<Value>& released) {
+        size_t bytes = kickOut(released);
+        if (!nodeMap_.empty() && freqToFreqList_[minFreq_]->isEmpty()) updateMinFreq();
+        return bytes;
+    }
+
+    // 由内存预算回调：按淘汰顺序移除至少 bytes 字节 | 返回移除的字节数
+    size_t evictForBudget(size_t bytes) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t freed = 0;
+        while (freed < bytes && meter_.enabled() && !nodeMap_.empty()) freed += kickOutInOrder(released);
+        return freed;
+    }
+
+    using FreqListMap = KUnorderedMap<int, std::shared_ptr<FreqListType>, Alloc>;
 
-    void kickOut();  // 移除缓存中的过期数据
+    void putInternal(Key key, Value value, KDeferredRelease<Value>& released);  // 添加缓存
+    void getInternal(NodePtr node, Value& value);                               // 获取缓存
+    void increaseFreq(NodePtr node);                                            // 访问频次+1
+
+    // 移除缓存中的过期数据，value 交给 released 在解锁后析构 | 返回释放的字节数，未加入内存预算时为 0
+    size_t kickOut(KDeferredRelease<Value>& released);
 
     void removeFromFreqList(NodePtr node);  // 从频率列表中移除节点
     void addToFreqList(NodePtr node);       // 添加到频率列表
@@ -137,21 +374,29 @@ private:
     void updateMinFreq();
 
 private:
-    int capacity_;                                                   // 缓存容量
+    std::atomic<int> capacity_;                                      // 缓存容量，可由 setCapacity 调整
     int minFreq_;                                                    // 最小访问频次(用于找到最小访问频次结点)
     int maxAverageNum_;                                              // 最大平均访问频次
     int curAverageNum_;                                              // 当前平均访问频次
     int curTotalNum_;                                                // 当前访问所有缓存次数总数
-    std::mutex mutex_;                                               // 互斥锁
+    Mutex mutex_;                                                    // 互斥锁
     NodeMap nodeMap_;                                                // key 到 缓存节点的映射
-    std::unordered_map<int, FreqList<Key, Value>*> freqToFreqList_;  // 访问频次到该频次链表的映射
+    FreqListMap freqToFreqList_;                                     // 访问频次到该频次链表的映射
+    std::shared_ptr<KBloomAdmissionFilter> admissionFilter_;         // 准入过滤器，为空表示全部准入
+    Alloc alloc_;                                                    // 结点与频次链表的分配器
+    KBudgetMeter<Key, Value> meter_;                                 // 内存预算的计费，未加入预算时不计费
 };
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::getInternal(NodePtr node, Value& value) {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::getInternal(NodePtr node, Value& value) {
     // 找到之后需要将其从低访问频次的链表中删除，并且添加到+1的访问频次链表中，
     // 访问频次+1, 然后把value值返回
     value = node->value;
+    increaseFreq(node);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::increaseFreq(NodePtr node) {
     // 从原有访问频次的链表中删除节点
     removeFromFreqList(node);
     node->freq++;
@@ -164,32 +409,41 @@ void KLfuCache<Key, Value>::getInternal(NodePtr node, Value& value) {
     addFreqNum();
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::putInternal(Key key, Value value) {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::putInternal(Key key, Value value, KDeferredRelease<Value>& released) {
+    // 调用方在加锁前检查过容量，期间容量可能被 setCapacity 改为 0，缓存已经清空
+    if (capacity_ <= 0) return;
     // 如果不在缓存中，则需要判断缓存是否已满
-    if (nodeMap_.size() == capacity_) {
+    if (nodeMap_.size() >= capacity_) {
+        // 需要淘汰才能放入时先经过准入过滤器，窗口内首次出现的 key 不挤占已有元素
+        if (admissionFilter_ && !admissionFilter_->admit(std::hash<Key>{}(key))) return;
         // 缓存已满，删除最不常访问的结点，更新当前平均访问频次和总访问频次
-        kickOut();
+        kickOut(released);
     }
 
     // 创建新结点，将新结点添加进入，更新最小访问频次
-    NodePtr node = std::make_shared<Node>(key, value);
+    NodePtr node = std::allocate_shared<Node>(alloc_, key, std::move(value));
     nodeMap_[key] = node;
     addToFreqList(node);
     addFreqNum();
     minFreq_ = std::min(minFreq_, 1);
+    meter_.inserted(node->key, node->value);
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::kickOut() {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+size_t KLfuCache<Key, Value, Alloc, Mutex>::kickOut(KDeferredRelease<Value>& released) {
+    if (nodeMap_.empty()) return 0;  // 清空后 minFreq_ 没有对应的频次链表
     NodePtr node = freqToFreqList_[minFreq_]->getFirstNode();
+    size_t bytes = meter_.evicted(node->key, node->value);
+    released.add(node->value);
     removeFromFreqList(node);
     nodeMap_.erase(node->key);
     decreaseFreqNum(node->freq);
+    return bytes;
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::removeFromFreqList(NodePtr node) {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::removeFromFreqList(NodePtr node) {
     // 检查结点是否为空
     if (!node) return;
 
@@ -197,8 +451,8 @@ void KLfuCache<Key, Value>::removeFromFreqList(NodePtr node) {
     freqToFreqList_[freq]->removeNode(node);
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::addToFreqList(NodePtr node) {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::addToFreqList(NodePtr node) {
     // 检查结点是否为空
     if (!node) return;
 
@@ -206,14 +460,14 @@ void KLfuCache<Key, Value>::addToFreqList(NodePtr node) {
     auto freq = node->freq;
     if (freqToFreqList_.find(node->freq) == freqToFreqList_.end()) {
         // 不存在则创建
-        freqToFreqList_[node->freq] = new FreqList<Key, Value>(node->freq);
+        freqToFreqList_[node->freq] = std::allocate_shared<FreqListType>(alloc_, node->freq, alloc_);
     }
 
     freqToFreqList_[freq]->addNode(node);
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::addFreqNum() {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::addFreqNum() {
     curTotalNum_++;
     if (nodeMap_.empty())
         curAverageNum_ = 0;
@@ -225,8 +479,8 @@ void KLfuCache<Key, Value>::addFreqNum() {
     }
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::decreaseFreqNum(int num) {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::decreaseFreqNum(int num) {
     // 减少平均访问频次和总访问频次
     curTotalNum_ -= num;
     if (nodeMap_.empty())
@@ -235,8 +489,8 @@ void KLfuCache<Key, Value>::decreaseFreqNum(int num) {
         curAverageNum_ = curTotalNum_ / nodeMap_.size();
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::handleOverMaxAverageNum() {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::handleOverMaxAverageNum() {
     if (nodeMap_.empty()) return;
 
     // 当前平均访问频次已经超过了最大平均访问频次，所有结点的访问频次- (maxAverageNum_ / 2)
@@ -261,8 +515,8 @@ void KLfuCache<Key, Value>::handleOverMaxAverageNum() {
     updateMinFreq();
 }
 
-template <typename Key, typename Value>
-void KLfuCache<Key, Value>::updateMinFreq() {
+template <typename Key, typename Value, typename Alloc, typename Mutex>
+void KLfuCache<Key, Value, Alloc, Mutex>::updateMinFreq() {
     minFreq_ = INT8_MAX;
     for (const auto& pair : freqToFreqList_) {
         if (pair.second && !pair.second->isEmpty()) {
@@ -273,27 +527,30 @@ void KLfuCache<Key, Value>::updateMinFreq() {
 }
 
 // 并没有牺牲空间换时间，他是把原有缓存大小进行了分片。
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class KHashLfuCache {
 public:
-    KHashLfuCache(size_t capacity, int sliceNum, int maxAverageNum = 10)
-        : sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency()), capacity_(capacity) {
-        size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum_));  // 每个lfu分片的容量
-        for (int i = 0; i < sliceNum_; ++i) {
-            lfuSliceCaches_.emplace_back(new KLfuCache<Key, Value>(sliceSize, maxAverageNum));
-        }
+    using SliceType = KLfuCache<Key, Value, Alloc, Mutex>;
+    using Shards = KReshardableSlices<Key, Value, SliceType>;
+
+    KHashLfuCache(size_t capacity, int sliceNum, int maxAverageNum = 10, const Alloc& alloc = Alloc())
+        : KHashLfuCache(capacity, sliceNum, maxAverageNum, [alloc](int) { return alloc; }) {}
+
+    // sliceAllocator(i) 返回第 i 个分片使用的分配器，例如每个分片一个独立的 memory_resource；
+    // 调用 reshard 扩容时还会用它为新增的分片创建分配器
+    KHashLfuCache(size_t capacity, int sliceNum, int maxAverageNum, const std::function<Alloc(int)>& sliceAllocator)
+        : shards_(capacity, sliceNum, [sliceAllocator, maxAverageNum](int i, size_t sliceSize) {
+              return new SliceType(sliceSize, maxAverageNum, sliceAllocator(i));
+          }) {
+        shards_.setIndexSeeder([](SliceType& slice, uint64_t seed) { slice.setHashSeed(seed); });
     }
 
     void put(Key key, Value value) {
-        // 根据key找出对应的lfu分片
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lfuSliceCaches_[sliceIndex]->put(key, value);
+        shards_.write(key, [&](SliceType& slice) { slice.put(key, value); });
     }
 
     bool get(Key key, Value& value) {
-        // 根据key找出对应的lfu分片
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lfuSliceCaches_[sliceIndex]->get(key, value);
+        return shards_.read(key, value, [&](SliceType& slice, Value& out) { return slice.get(key, out); });
     }
 
     Value get(Key key) {
@@ -302,24 +559,129 @@ public:
         return value;
     }
 
+    bool remove(Key key) { return shards_.remove(key); }
+
+    // 批量查询：先按分片分组，每个分片只加一次锁 | 返回命中数
+    size_t getBatch(const Key* keys, size_t count, Value* values, bool* found) {
+        auto route = shards_.route();
+        if (route.migrating()) return getEach(keys, count, values, found);
+
+        std::vector<size_t> order, offsets;
+        groupBySlice(keys, count, route, order, offsets);
+        size_t hits = 0;
+        for (int i = 0; i < route.to(); ++i) {
+            size_t n = offsets[i + 1] - offsets[i];
+            if (n > 0) hits += shards_.slice(i).getBatch(keys, order.data() + offsets[i], n, values, found);
+        }
+        if (!shards_.changedSince(route)) return hits;
+        // 查询期间开始了迁移：未命中的 key 可能已被移走，逐个按新的路由重查
+        for (size_t i = 0; i < count; ++i) {
+            if (!found[i] && get(keys[i], values[i])) {
+                found[i] = true;
+                ++hits;
+            }
+        }
+        return hits;
+    }
+
+    // 批量写入：先按分片分组，每个分片只加一次锁（同一个key的多次写入保持原有顺序）
+    void putBatch(const Key* keys, const Value* values, size_t count) {
+        auto route = shards_.route();
+        if (!route.migrating()) {
+            std::vector<size_t> order, offsets;
+            groupBySlice(keys, count, route, order, offsets);
+            for (int i = 0; i < route.to(); ++i) {
+                size_t n = offsets[i + 1] - offsets[i];
+                if (n > 0) shards_.slice(i).putBatch(keys, values, order.data() + offsets[i], n);
+            }
+            if (!shards_.changedSince(route)) return;
+        }
+        // 迁移中，或写入期间开始了迁移：逐个按当前路由写入
+        for (size_t i = 0; i < count; ++i) {
+            shards_.write(keys[i], [&](SliceType& slice) { slice.put(keys[i], values[i]); });
+        }
+    }
+
+    // 在线调整分片数，见 KHashLruCaches::reshard。迁移到新分片的元素访问频次从 1 重新开始
+    bool reshard(int sliceNum) { return shards_.reshard(sliceNum); }
+
+    bool resharding() const { return shards_.resharding(); }
+
+    void waitForReshard() { shards_.waitForReshard(); }
+
+    int sliceNum() const { return shards_.sliceNum(); }
+
+    // 调整总容量（例如在内存压力下收缩），超出的元素按淘汰顺序移除，见 KReshardableSlices::setCapacity
+    void setCapacity(size_t capacity) { shards_.setCapacity(capacity); }
+
+    size_t capacity() const { return shards_.capacity(); }
+
+    // 分片选择与各分片内部的哈希表改用带种子的哈希（KSeededHash.h），分片选择按新的种子在后台重新分布，
+    // 各分片的哈希表由迁移线程在各自的锁内重建，倾斜检测触发的换种子同样如此。种子为 0 时恢复 std::hash |
+    // 正在调整分片时返回false
+    bool setHashSeed(uint64_t seed = randomSeed()) { return shards_.reseed(seed); }
+
+    uint64_t hashSeed() const { return shards_.seed(); }
+
+    // 开启负载倾斜检测：某个分片的写入次数超过平均值的 threshold 倍时自动换一个随机种子重新分布，
+    // 见 KReshardableSlices::enableSkewDetection
+    void enableSkewDetection(double threshold = 2.0, size_t window = 1 << 16) {
+        shards_.enableSkewDetection(threshold, window);
+    }
+
+    // 倾斜检测触发的换种子次数
+    size_t skewReseeds() const { return shards_.skewReseeds(); }
+
+    // 所有分片共享同一个准入过滤器，见 KLfuCache::setAdmissionFilter
+    void setAdmissionFilter(std::shared_ptr<KBloomAdmissionFilter> filter) {
+        shards_.configure("admission", [filter](SliceType& slice) { slice.setAdmissionFilter(filter); });
+    }
+
+    // 所有分片以同一个名字加入内存预算，各自计费与淘汰，统计时合并，见 KLfuCache::setMemoryBudget
+    void setMemoryBudget(std::shared_ptr<KCacheBudget> budget, const std::string& name = "",
+                         typename SliceType::EntryBytes entryBytes = nullptr) {
+        shards_.configure("budget", [budget, name, entryBytes](SliceType& slice) {
+            slice.setMemoryBudget(budget, name, entryBytes);
+        });
+    }
+
     // 清除缓存
     void purge() {
-        for (auto& lfuSliceCache : lfuSliceCaches_) {
-            lfuSliceCache->purge();
-        }
+        shards_.removeEverywhere([this](const typename Shards::Route&) {
+            shards_.forEachSlice([](SliceType& slice) { slice.purge(); });
+            return size_t(0);
+        });
     }
 
 private:
-    // 将key计算成对应哈希值
-    size_t Hash(Key key) {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+    size_t getEach(const Key* keys, size_t count, Value* values, bool* found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            found[i] = get(keys[i], values[i]);
+            hits += found[i];
+        }
+        return hits;
+    }
+
+    // 计数排序：order[offsets[i]..offsets[i+1]) 为落在第i个分片的key下标，分片内保持原有顺序
+    void groupBySlice(const Key* keys, size_t count, const typename Shards::Route& route, std::vector<size_t>& order,
+                      std::vector<size_t>& offsets) {
+        int sliceNum = route.to();
+        std::vector<int> sliceOf(count);
+        offsets.assign(sliceNum + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            sliceOf[i] = shards_.sliceOf(keys[i], route);
+            ++offsets[sliceOf[i] + 1];
+        }
+        for (int i = 0; i < sliceNum; ++i) offsets[i + 1] += offsets[i];
+
+        order.resize(count);
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < count; ++i) order[next[sliceOf[i]]++] = i;
     }
 
 private:
-    size_t capacity_;                                                     // 缓存总容量
-    int sliceNum_;                                                        // 缓存分片数量
-    std::vector<std::unique_ptr<KLfuCache<Key, Value>>> lfuSliceCaches_;  // 缓存lfu分片容器
+    Shards shards_;  // 缓存lfu分片，可在线调整分片数
 };
 
 }  // namespace KamaCache
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace KamaCache {
+
+// 缓存引擎的 Mutex 模板参数可以是 std::mutex（默认）、KSpinParkMutex 或 KMcsMutex，需要 lock/unlock，
+// KFlatCombiningLruCache 的合并锁还需要 try_lock。
+// 缓存的临界区通常只有几十到一百纳秒，std::mutex 在竞争时很快进入 futex 系统调用与上下文切换，
+// 而持锁者往往马上就会释放：先在用户态有限地自旋，等不到再挂起
+
+namespace detail {
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// 在 *word == expected 时挂起，直到被 futexWake 唤醒（可能虚假唤醒，调用者需要重新检查）
+inline void futexWait(std::atomic<int>* word, int expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    if (word->load(std::memory_order_relaxed) == expected) std::this_thread::yield();
+#endif
+}
+
+inline void futexWake(std::atomic<int>* word, int count) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)count;
+#endif
+}
+
+// 单核机器上持锁者不可能同时在运行，自旋没有意义
+inline int maxSpins(int limit) {
+    static const bool multiCore = std::thread::hardware_concurrency() > 1;
+    return multiCore ? limit : 0;
+}
+
+}  // namespace detail
+
+// 自适应自旋后挂起的互斥锁。状态：0 空闲，1 被持有，2 被持有且可能有线程挂起（释放时需要唤醒）。
+// 加锁先按指数退避自旋，自旋上限随最近的结果调整：自旋成功则放宽，最终仍要挂起则收紧，
+// 临界区短时几乎不进入内核，临界区变长后自动退化为直接挂起，不在自旋上浪费 CPU。非公平，与 std::mutex 相同
+class KSpinParkMutex {
+public:
+    KSpinParkMutex() = default;
+    KSpinParkMutex(const KSpinParkMutex&) = delete;
+    KSpinParkMutex& operator=(const KSpinParkMutex&) = delete;
+
+    void lock() {
+        int expected = 0;
+        if (state_.compare_exchange_strong(expected, 1, std::memory_order_acquire)) return;
+
+        int limit = detail::maxSpins(spinLimit_.load(std::memory_order_relaxed));
+        int backoff = 1;
+        for (int spins = 0; spins < limit; spins += backoff, backoff = std::min(backoff * 2, kMaxBackoff)) {
+            for (int i = 0; i < backoff; ++i) detail::cpuRelax();
+            expected = 0;
+            if (state_.load(std::memory_order_relaxed) == 0 &&
+                state_.compare_exchange_weak(expected, 1, std::memory_order_acquire)) {
+                adjustSpinLimit(spins * 2);
+                return;
+            }
+        }
+        adjustSpinLimit(limit / 2);
+
+        // 挂起：把状态置为 2，使持锁者释放时唤醒
+        while (state_.exchange(2, std::memory_order_acquire) != 0) detail::futexWait(&state_, 2);
+    }
+
+    bool try_lock() {
+        int expected = 0;
+        return state_.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        if (state_.exchange(0, std::memory_order_release) == 2) detail::futexWake(&state_, 1);
+    }
+
+private:
+    // 按最近一次自旋的结果平滑调整自旋上限
+    void adjustSpinLimit(int observed) {
+        int limit = spinLimit_.load(std::memory_order_relaxed);
+        int next = std::clamp(limit + (observed - limit) / 8, kMinSpins, kMaxSpins);
+        spinLimit_.store(next, std::memory_order_relaxed);
+    }
+
+    static constexpr int kMaxBackoff = 64;  // 两次尝试之间最多的 pause 次数
+    static constexpr int kMinSpins = 16;
+    static constexpr int kMaxSpins = 4096;
+
+    alignas(64) std::atomic<int> state_{0};
+    std::atomic<int> spinLimit_{256};  // 当前的自旋上限（pause 次数）
+};
+
+// MCS 队列锁：等待的线程按到达顺序排队，每个线程只在自己的队列结点上自旋，释放时直接交给下一个线程。
+// 竞争激烈时锁所在的缓存行不再在所有等待者之间来回迁移，并且保证先来先得；等待超过自旋上限后在自己的结点上挂起。
+// 队列结点来自线程局部的结点池，同一个线程可以同时持有多把 MCS 锁。
+// 严格先来先得的代价是线程数超过 CPU 核数时，锁会交给一个尚未被调度的线程，所有后继一起等待它被调度，
+// 只适合线程数不超过核数（例如每个核一个工作线程）的部署
+class KMcsMutex {
+public:
+    KMcsMutex() = default;
+    KMcsMutex(const KMcsMutex&) = delete;
+    KMcsMutex& operator=(const KMcsMutex&) = delete;
+
+    void lock() {
+        Node* node = acquireNode();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->state.store(kWaiting, std::memory_order_relaxed);
+        Node* prev = tail_.exchange(node, std::memory_order_acq_rel);
+        if (prev) {
+            prev->next.store(node, std::memory_order_release);
+            int limit = detail::maxSpins(kSpins);
+            for (int spins = 0; spins < limit && node->state.load(std::memory_order_acquire) == kWaiting; ++spins) {
+                detail::cpuRelax();
+            }
+            int expected = kWaiting;
+            if (node->state.compare_exchange_strong(expected, kParked, std::memory_order_acquire)) {
+                while (node->state.load(std::memory_order_acquire) == kParked) detail::futexWait(&node->state, kParked);
+            }
+        }
+        holder_ = node;
+    }
+
+    // 队列为空时直接入队成为持锁者，否则不排队
+    bool try_lock() {
+        Node* node = acquireNode();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->state.store(kWaiting, std::memory_order_relaxed);
+        Node* expected = nullptr;
+        if (!tail_.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)) {
+            releaseNode(node);
+            return false;
+        }
+        holder_ = node;
+        return true;
+    }
+
+    void unlock() {
+        Node* node = holder_;
+        Node* next = node->next.load(std::memory_order_acquire);
+        if (!next) {
+            Node* expected = node;
+            if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+                releaseNode(node);
+                return;
+            }
+            // 后继已经进入队列但还没有链接到本结点
+            while (!(next = node->next.load(std::memory_order_acquire))) detail::cpuRelax();
+        }
+        if (next->state.exchange(kGranted, std::memory_order_release) == kParked) detail::futexWake(&next->state, 1);
+        releaseNode(node);
+    }
+
+private:
+    enum { kWaiting, kParked, kGranted };
+
+    struct alignas(64) Node {
+        std::atomic<Node*> next{nullptr};
+        std::atomic<int> state{kWaiting};  // 同时作为挂起时的 futex 字
+    };
+
+    static std::vector<std::unique_ptr<Node>>& nodePool() {
+        thread_local std::vector<std::unique_ptr<Node>> pool;
+        return pool;
+    }
+
+    static Node* acquireNode() {
+        auto& pool = nodePool();
+        if (pool.empty()) return new Node();
+        Node* node = pool.back().release();
+        pool.pop_back();
+        return node;
+    }
+
+    static void releaseNode(Node* node) { nodePool().emplace_back(node); }
+
+    static constexpr int kSpins = 1024;  // 挂起前在自己的结点上自旋的 pause 次数
+
+    alignas(64) std::atomic<Node*> tail_{nullptr};
+    Node* holder_ = nullptr;  // 当前持锁线程的结点，只由持锁线程读写
+};
+
+}  // namespace KamaCache
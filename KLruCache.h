@@ -1,30 +1,58 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
-#include <thread>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include "KAdmissionFilter.h"
+#include "KAllocator.h"
+#include "KCacheBudget.h"
+#include "KDeferredRelease.h"
 #include "KICachePolicy.h"
+#include "KLock.h"
+#include "KReshard.h"
+#include "KSeededHash.h"
+#include "KScanDetector.h"
 
 namespace KamaCache {
 
 // 前向声明
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class KLruCache;
 
+// 命中时的提升方式
+enum class KLruPromotion {
+    Eager,        // 每次命中都移动到最新位置（默认）
+    Reinsertion,  // 命中只记录访问标记，结点到达淘汰端时若被访问过则重新插入到最新位置（FIFO-Reinsertion）
+    Throttled,    // 同一个结点在一个时间窗口内最多提升一次
+};
+
 template <typename Key, typename Value>
 class LruNode {
 private:
     Key key_;
     Value value_;
     size_t accessCount_;  // 访问次数
+    bool visited_;        // 延迟提升模式下的访问标记
+    int64_t promotedAt_;  // 限频提升模式下上一次提升的时间
+    uint64_t version_;    // 版本号，每次写入都会更新，见 KLruCache::getWithVersion
     std::shared_ptr<LruNode<Key, Value>> prev_;
     std::shared_ptr<LruNode<Key, Value>> next_;
 
 public:
-    LruNode(Key key, Value value) : key_(key), value_(value), accessCount_(1), prev_(nullptr), next_(nullptr) {}
+    LruNode(Key key, Value value)
+        : key_(key), value_(std::move(value)), accessCount_(1), visited_(false), promotedAt_(0), version_(0), prev_(nullptr),
+          next_(nullptr) {}
 
     // 提供必要的访问器
     Key getKey() const { return key_; }
@@ -37,43 +65,61 @@ public:
 
     void incrementAccessCount() { ++accessCount_; }
 
-    friend class KLruCache<Key, Value>;
+    template <typename K, typename V, typename A, typename M>
+    friend class KLruCache;
 };
 
-template <typename Key, typename Value>
+// Alloc 用于结点、哈希表与哈希索引的内存分配，见 KAllocator.h；Mutex 为分片锁的类型，见 KLock.h
+template <typename Key, typename Value, typename Alloc, typename Mutex>
 class KLruCache : public KICachePolicy<Key, Value> {
 public:
     using LruNodeType = LruNode<Key, Value>;
     using NodePtr = std::shared_ptr<LruNodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
-
-    KLruCache(int capacity) : capacity_(capacity) { initializeList(); }
+    using NodeMap = KUnorderedMap<Key, NodePtr, Alloc, KSeededHash<Key>>;  // 默认不带种子，见 setHashSeed
+    using allocator_type = Alloc;
+    using EntryBytes = typename KBudgetMeter<Key, Value>::EntryBytes;
+
+    KLruCache(int capacity, const Alloc& alloc = Alloc())
+        : capacity_(capacity),
+          nodeMap_(typename NodeMap::allocator_type(alloc)),
+          hashIndex_(typename HashIndex::allocator_type(alloc)),
+          alloc_(alloc),
+          meter_(kNodeBytes) {
+        initializeList();
+    }
 
-    ~KLruCache() override = default;
+    // 先退出内存预算，之后预算不会再回调本缓存；结点归分配器所有，析构时断开链表使结点真正释放
+    ~KLruCache() override {
+        setMemoryBudget(nullptr);
+        unlinkAll();
+    }
 
     // 添加缓存
     void put(Key key, Value value) override {
         if (capacity_ <= 0) return;
 
-        std::lock_guard<std::mutex> lock(mutex_);
+        KDeferredRebalance pending;        // 超出内存预算时在解锁后回收
+        KDeferredRelease<Value> released;  // 被覆盖或淘汰的 value 在解锁后析构
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = nodeMap_.find(key);
         if (it != nodeMap_.end()) {
             // 如果在当前容器中,则更新value,并调用get方法，代表该数据刚被访问
-            updateExistingNode(it->second, value);
-            return;
+            updateExistingNode(it->second, std::move(value), released);
+        } else {
+            addNewNode(key, std::move(value), released);
         }
-
-        addNewNode(key, value);
+        meter_.check(pending);
     }
 
     bool get(Key key, Value& value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = nodeMap_.find(key);
         if (it != nodeMap_.end()) {
-            moveToMostRecent(it->second);
+            touch(it->second);
             value = it->second->getValue();
             return true;
         }
+        meter_.missed(key);
         return false;
     }
 
@@ -85,72 +131,495 @@ public:
         return value;
     }
 
-    // 删除指定元素
-    void remove(Key key) {
-        std::lock_guard<std::mutex> lock(mutex_);
+    // 查询但不改变元素的新旧顺序
+    bool peek(Key key, Value& value) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) return false;
+        value = it->second->getValue();
+        return true;
+    }
+
+    // 只更新已存在元素的value，不改变新旧顺序 | 元素不存在时返回false
+    bool replace(Key key, Value value) {
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) return false;
+        assignValue(it->second, std::move(value), released);
+        meter_.check(pending);
+        return true;
+    }
+
+    // 查询并取得元素的版本号，命中时与 get 一样提升 | 未命中时 version 为 0 并返回false
+    bool getWithVersion(Key key, Value& value, uint64_t& version) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) {
+            meter_.missed(key);
+            version = 0;
+            return false;
+        }
+        touch(it->second);
+        value = it->second->getValue();
+        version = it->second->version_;
+        return true;
+    }
+
+    // 只查询版本号，不改变新旧顺序 | 元素不存在时返回 0
+    uint64_t versionOf(Key key) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        return it != nodeMap_.end() ? it->second->version_ : 0;
+    }
+
+    // 比较并写入：元素的版本号等于 expected 时写入并分配新的版本号，expected 为 0 表示元素不存在时才写入 |
+    // 写入时返回true。比较与写入在同一次加锁内完成，乐观更新的调用方失败后重新 getWithVersion 再试。
+    // 插入新元素时不经过准入过滤器，否则被拒绝的调用方会一直重试
+    bool putIfVersion(Key key, Value value, uint64_t expected) {
+        return putIfVersion(key, std::move(value), expected, [](bool) { return true; });
+    }
+
+    // 同上，valid(inserting) 在锁内比较通过之后、写入之前调用，返回false时不写入并返回false。
+    // 分片缓存用它在分片的锁内确认路由没有变化，见 KReshardableSlices::writeIf
+    template <typename Valid>
+    bool putIfVersion(Key key, Value value, uint64_t expected, Valid valid) {
+        if (capacity_ <= 0) return false;
+
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        bool found = it != nodeMap_.end();
+        if ((found ? it->second->version_ : 0) != expected || !valid(!found)) return false;
+        if (found) {
+            updateExistingNode(it->second, std::move(value), released);
+        } else {
+            if (capacity_ <= 0) return false;  // 加锁前检查之后容量可能被 setCapacity 改为 0
+            if (nodeMap_.size() >= capacity_) evictLeastRecent(released);
+            insertNode(createNode(key, std::move(value)));
+        }
+        meter_.check(pending);
+        return true;
+    }
+
+    // 版本号取 index + k * count（k >= 1）。分片缓存为每个分片设置不同的 index，版本号在所有分片之间都不重复，
+    // 元素迁移到其他分片或被淘汰后重新写入都不会得到用过的版本号（不会出现 ABA）
+    void setVersionSpace(uint32_t index, uint32_t count) {
+        std::lock_guard<Mutex> lock(mutex_);
+        versionStride_ = count;
+        lastVersion_ = lastVersion_ / count * count + index;  // 之后分配的版本号仍大于已经用过的
+    }
+
+    // 以最旧的身份写入：已存在时只更新value不提升，否则插入到淘汰端，供扫描流量使用
+    void putCold(Key key, Value value) {
+        if (capacity_ <= 0) return;
+
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
         auto it = nodeMap_.find(key);
         if (it != nodeMap_.end()) {
+            assignValue(it->second, std::move(value), released);
+            meter_.check(pending);
+            return;
+        }
+        if (capacity_ <= 0) return;
+        if (nodeMap_.size() >= capacity_) {
+            if (admissionFilter_ && !admissionFilter_->admit(keyHash(key))) return;
+            evictLeastRecent(released);
+        }
+        insertNodeAtLeastRecent(createNode(key, std::move(value)));
+        meter_.check(pending);
+    }
+
+    // 批量查询：一次加锁查找 keys[indices[0..count)]（indices 为空时依次为 0..count-1），
+    // 命中时写入相同下标的 values 并置 found | 返回命中数
+    // 每 kPrefetchGroup 个 key 为一组分两趟处理：先逐个查找（每个 key 只哈希一次）并预取命中的 LruNode，
+    // 再读取与提升，组内各结点的缓存未命中互相重叠。std::unordered_map 不暴露桶数组的地址，查找本身的访存无法预取。
+    // withPrefetch 为 false 时不预取，其余完全相同，用于衡量预取本身（而非一次加锁）带来的收益
+    size_t getBatch(const Key* keys, const size_t* indices, size_t count, Value* values, bool* found,
+                    bool withPrefetch = true) {
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t hits = 0;
+        typename NodeMap::iterator its[kPrefetchGroup];
+        for (size_t base = 0; base < count; base += kPrefetchGroup) {
+            size_t n = std::min(kPrefetchGroup, count - base);
+            for (size_t i = 0; i < n; ++i) {
+                its[i] = nodeMap_.find(keys[indices ? indices[base + i] : base + i]);
+                if (withPrefetch && its[i] != nodeMap_.end()) prefetch(its[i]->second.get());
+            }
+            for (size_t i = 0; i < n; ++i) {
+                size_t k = indices ? indices[base + i] : base + i;
+                found[k] = its[i] != nodeMap_.end();
+                if (found[k]) {
+                    touch(its[i]->second);
+                    values[k] = its[i]->second->getValue();
+                    ++hits;
+                } else {
+                    meter_.missed(keys[k]);
+                }
+            }
+        }
+        return hits;
+    }
+
+    // 批量写入：一次加锁按顺序写入 keys/values[indices[0..count)]（indices 为空时依次为 0..count-1）
+    void putBatch(const Key* keys, const Value* values, const size_t* indices, size_t count) {
+        if (capacity_ <= 0) return;
+
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            size_t k = indices ? indices[i] : i;
+            auto it = nodeMap_.find(keys[k]);
+            if (it != nodeMap_.end()) {
+                updateExistingNode(it->second, values[k], released);
+            } else {
+                addNewNode(keys[k], values[k], released);
+            }
+        }
+        meter_.check(pending);
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end()) {
+            meter_.erased(it->first, it->second->value_);
+            released.add(it->second->value_);
+            removeNode(it->second);
+            eraseFromHashIndex(it->second);
+            nodeMap_.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    // 清空缓存
+    void purge() {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        for (auto& entry : nodeMap_) {
+            meter_.erased(entry.first, entry.second->value_);
+            released.add(entry.second->value_);
+        }
+        unlinkAll();
+        nodeMap_.clear();
+        hashIndex_.clear();
+        initializeList();
+    }
+
+    // 从最新一端起复制至多 limit 个元素追加到 out，不改变新旧顺序 | 返回复制的元素个数
+    size_t collectRecent(size_t limit, std::vector<std::pair<Key, Value>>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t collected = 0;
+        for (NodePtr node = dummyTail_->prev_; node != dummyHead_ && collected < limit; node = node->prev_) {
+            out.emplace_back(node->getKey(), node->getValue());
+            ++collected;
+        }
+        return collected;
+    }
+
+    // 不存在时写入，用于迁入已经在其他缓存中的元素：不经过准入过滤器 | key 已存在时不覆盖并返回false
+    bool putIfAbsent(Key key, Value value) {
+        if (capacity_ <= 0) return false;
+
+        KDeferredRebalance pending;
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        if (capacity_ <= 0 || nodeMap_.find(key) != nodeMap_.end()) return false;
+        if (nodeMap_.size() >= capacity_) evictLeastRecent(released);
+        insertNode(createNode(key, std::move(value)));
+        meter_.check(pending);
+        return true;
+    }
+
+    // 一次加锁取出 keys[0..count) 中存在的元素：从缓存中删除，并把 key 与 value 追加到 out | 返回取出的个数
+    size_t extract(const Key* keys, size_t count, std::vector<std::pair<Key, Value>>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t extracted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto it = nodeMap_.find(keys[i]);
+            if (it == nodeMap_.end()) continue;
+            meter_.erased(it->first, it->second->value_);
+            out.emplace_back(it->first, std::move(it->second->value_));
             removeNode(it->second);
+            eraseFromHashIndex(it->second);
             nodeMap_.erase(it);
+            ++extracted;
+        }
+        return extracted;
+    }
+
+    // 按从旧到新的顺序复制所有 key 追加到 out
+    void collectKeys(std::vector<Key>& out) {
+        std::lock_guard<Mutex> lock(mutex_);
+        out.reserve(out.size() + nodeMap_.size());
+        for (NodePtr node = dummyHead_->next_; node != dummyTail_; node = node->next_) out.push_back(node->key_);
+    }
+
+    // 调整容量，超出新容量的元素按淘汰顺序移除
+    void setCapacity(int capacity) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        capacity_ = capacity;
+        while (!nodeMap_.empty() && nodeMap_.size() > static_cast<size_t>(std::max(capacity, 0))) {
+            evictLeastRecent(released);
+        }
+    }
+
+    int capacity() const { return capacity_; }
+
+    // 用带种子的哈希函数重建 key 到结点的哈希表（种子为 0 时恢复 std::hash），防止构造的 key 集中到少数哈希桶。
+    // 需要在锁内重新插入所有元素，适合在开始使用缓存前或低峰期调用
+    void setHashSeed(uint64_t seed) {
+        std::lock_guard<Mutex> lock(mutex_);
+        NodeMap rebuilt(nodeMap_.begin(), nodeMap_.end(), nodeMap_.bucket_count(), KSeededHash<Key>(seed),
+                        std::equal_to<Key>(), nodeMap_.get_allocator());
+        nodeMap_.swap(rebuilt);
+    }
+
+    // 开启 key 哈希索引，之后可以只凭 key 的哈希值（keyHash）删除元素，供跨进程失效通知使用
+    void enableHashIndex() {
+        std::lock_guard<Mutex> lock(mutex_);
+        if (hashIndexEnabled_) return;
+        hashIndexEnabled_ = true;
+        for (auto& entry : nodeMap_) hashIndex_.emplace(keyHash(entry.first), entry.second);
+    }
+
+    // 一次加锁删除哈希值属于 hashes 的所有元素（需先 enableHashIndex） | 返回删除的元素个数
+    size_t removeByHashes(const uint64_t* hashes, size_t count) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t removed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto range = hashIndex_.equal_range(hashes[i]);
+            for (auto it = range.first; it != range.second; ++it) {
+                meter_.erased(it->second->getKey(), it->second->value_);
+                released.add(it->second->value_);
+                removeNode(it->second);
+                nodeMap_.erase(it->second->getKey());
+                ++removed;
+            }
+            hashIndex_.erase(range.first, range.second);
         }
+        return removed;
+    }
+
+    // 同 removeByHashes，与 KHashLruCaches 的接口同名，单个 KLruCache 也可以订阅失效通知（KInvalidationSubscriber）
+    size_t invalidateHashes(const uint64_t* hashes, size_t count) { return removeByHashes(hashes, count); }
+
+    // 设置命中时的提升方式，window 为 Throttled 模式下同一结点两次提升的最小间隔
+    void setPromotion(KLruPromotion promotion, std::chrono::nanoseconds window = std::chrono::milliseconds(1)) {
+        std::lock_guard<Mutex> lock(mutex_);
+        promotion_ = promotion;
+        promotionWindow_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(window).count();
+    }
+
+    // 设置准入过滤器（可与其他缓存共享），缓存已满时新 key 需要通过过滤器才会淘汰旧元素并进入缓存；传入空指针关闭
+    void setAdmissionFilter(std::shared_ptr<KBloomAdmissionFilter> filter) {
+        std::lock_guard<Mutex> lock(mutex_);
+        admissionFilter_ = std::move(filter);
+    }
+
+    // 加入全局内存预算（见 KCacheBudget.h，可与其他缓存共享）：每个元素按 entryBytes 计费，为空时按结点开销加上
+    // key、value 的堆内存估算；超出预算时由预算决定从哪个缓存淘汰。name 用于预算的统计。传入空指针退出预算
+    void setMemoryBudget(std::shared_ptr<KCacheBudget> budget, std::string name = "", EntryBytes entryBytes = nullptr) {
+        std::unique_ptr<KCacheBudget::Account> account;
+        if (budget) account = budget->join(std::move(name), [this](size_t bytes) { return evictForBudget(bytes); });
+        KDeferredRebalance pending;
+        std::lock_guard<Mutex> lock(mutex_);
+        account = meter_.setAccount(std::move(account), std::move(entryBytes));
+        for (auto& entry : nodeMap_) meter_.inserted(entry.first, entry.second->value_);
+        meter_.check(pending);
     }
 
+    // 失效通知中使用的 key 哈希值。std::hash 不带随机种子，同一份程序的不同进程得到的值相同
+    static uint64_t keyHash(const Key& key) { return std::hash<Key>{}(key); }
+
 private:
+    using HashIndex = KUnorderedMultimap<uint64_t, NodePtr, Alloc>;
+
+    static constexpr size_t kPrefetchGroup = 16;  // 批量查询中同时在途的 key 个数
+    // 每个元素固定的内存开销：结点与 shared_ptr 控制块、哈希表结点与桶
+    static constexpr size_t kNodeBytes = sizeof(LruNodeType) + sizeof(typename NodeMap::value_type) + 4 * sizeof(void*);
+
+    static void prefetch(const void* address) {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // 由内存预算回调：按淘汰顺序移除至少 bytes 字节 | 返回移除的字节数
+    size_t evictForBudget(size_t bytes) {
+        KDeferredRelease<Value> released;
+        std::lock_guard<Mutex> lock(mutex_);
+        size_t freed = 0;
+        while (freed < bytes && meter_.enabled() && !nodeMap_.empty()) freed += evictLeastRecent(released);
+        return freed;
+    }
+
+    // 结点之间用 shared_ptr 双向相连，先断开链表避免循环引用
+    void unlinkAll() {
+        NodePtr node = dummyHead_;
+        while (node) {
+            NodePtr next = node->next_;
+            node->prev_ = nullptr;
+            node->next_ = nullptr;
+            node = next;
+        }
+    }
+
     void initializeList() {
         // 创建首尾虚拟节点
-        dummyHead_ = std::make_shared<LruNodeType>(Key(), Value());
-        dummyTail_ = std::make_shared<LruNodeType>(Key(), Value());
+        dummyHead_ = std::allocate_shared<LruNodeType>(alloc_, Key(), Value());
+        dummyTail_ = std::allocate_shared<LruNodeType>(alloc_, Key(), Value());
         dummyHead_->next_ = dummyTail_;
         dummyTail_->prev_ = dummyHead_;
     }
 
-    void updateExistingNode(NodePtr node, const Value& value) {
-        node->setValue(value);
-        moveToMostRecent(node);
+    void updateExistingNode(const NodePtr& node, Value value, KDeferredRelease<Value>& released) {
+        assignValue(node, std::move(value), released);
+        touch(node);
+    }
+
+    // 覆盖 value，旧值交给 released 在解锁后析构
+    void assignValue(const NodePtr& node, Value value, KDeferredRelease<Value>& released) {
+        meter_.erased(node->key_, node->value_);
+        released.add(node->value_);
+        node->value_ = std::move(value);
+        node->version_ = nextVersion();
+        meter_.inserted(node->key_, node->value_);
     }
 
-    void addNewNode(const Key& key, const Value& value) {
+    // 记录一次命中，按提升方式决定是否移动结点。延迟模式下命中不修改链表指针，减少热点结点的缓存行争用
+    void touch(const NodePtr& node) {
+        switch (promotion_) {
+            case KLruPromotion::Eager:
+                moveToMostRecent(node);
+                break;
+            case KLruPromotion::Reinsertion:
+                if (!node->visited_) node->visited_ = true;
+                break;
+            case KLruPromotion::Throttled: {
+                int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+                if (now - node->promotedAt_ >= promotionWindow_) {
+                    node->promotedAt_ = now;
+                    moveToMostRecent(node);
+                }
+                break;
+            }
+        }
+    }
+
+    // value 按值传入并移动进结点，put 传入的大对象在锁内不再复制
+    void addNewNode(const Key& key, Value value, KDeferredRelease<Value>& released) {
+        // 调用方在加锁前检查过容量，期间容量可能被 setCapacity 改为 0，缓存已经清空
+        if (capacity_ <= 0) return;
         if (nodeMap_.size() >= capacity_) {
-            evictLeastRecent();
+            // 需要淘汰才能放入时先经过准入过滤器，窗口内首次出现的 key 不挤占已有元素
+            if (admissionFilter_ && !admissionFilter_->admit(keyHash(key))) return;
+            evictLeastRecent(released);
         }
 
-        NodePtr newNode = std::make_shared<LruNodeType>(key, value);
-        insertNode(newNode);
-        nodeMap_[key] = newNode;
+        insertNode(createNode(key, std::move(value)));
+    }
+
+    // 创建结点并加入哈希表、哈希索引与内存预算，分配新的版本号，由调用方链入链表
+    NodePtr createNode(const Key& key, Value value) {
+        NodePtr node = std::allocate_shared<LruNodeType>(alloc_, key, std::move(value));
+        node->version_ = nextVersion();
+        nodeMap_[key] = node;
+        if (hashIndexEnabled_) hashIndex_.emplace(keyHash(key), node);
+        meter_.inserted(key, node->value_);
+        return node;
+    }
+
+    uint64_t nextVersion() {
+        lastVersion_ += versionStride_;
+        return lastVersion_;
     }
 
     // 将该节点移动到最新的位置
-    void moveToMostRecent(NodePtr node) {
+    void moveToMostRecent(const NodePtr& node) {
         removeNode(node);
         insertNode(node);
     }
 
-    void removeNode(NodePtr node) {
+    void removeNode(const NodePtr& node) {
         node->prev_->next_ = node->next_;
         node->next_->prev_ = node->prev_;
     }
 
     // 从尾部插入结点
-    void insertNode(NodePtr node) {
+    void insertNode(const NodePtr& node) {
         node->next_ = dummyTail_;
         node->prev_ = dummyTail_->prev_;
         dummyTail_->prev_->next_ = node;
         dummyTail_->prev_ = node;
     }
 
-    // 驱逐最近最少访问
-    void evictLeastRecent() {
+    // 从头部（淘汰端）插入结点
+    void insertNodeAtLeastRecent(NodePtr node) {
+        node->prev_ = dummyHead_;
+        node->next_ = dummyHead_->next_;
+        dummyHead_->next_->prev_ = node;
+        dummyHead_->next_ = node;
+    }
+
+    // 驱逐最近最少访问，被淘汰的 value 交给 released 在解锁后析构 | 返回释放的字节数，未加入内存预算时为 0
+    size_t evictLeastRecent(KDeferredRelease<Value>& released) {
+        if (nodeMap_.empty()) return 0;  // 链表中只有虚拟结点
+        if (promotion_ == KLruPromotion::Reinsertion) {
+            // 被访问过的结点清除标记后重新插入到最新位置，最多遍历一轮
+            while (dummyHead_->next_ != dummyTail_ && dummyHead_->next_->visited_) {
+                NodePtr node = dummyHead_->next_;
+                node->visited_ = false;
+                moveToMostRecent(node);
+            }
+        }
         NodePtr leastRecent = dummyHead_->next_;
+        size_t bytes = meter_.evicted(leastRecent->key_, leastRecent->value_);
+        released.add(leastRecent->value_);
         removeNode(leastRecent);
+        eraseFromHashIndex(leastRecent);
         nodeMap_.erase(leastRecent->getKey());
+        return bytes;
+    }
+
+    void eraseFromHashIndex(const NodePtr& node) {
+        if (!hashIndexEnabled_) return;
+        auto range = hashIndex_.equal_range(keyHash(node->getKey()));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == node) {
+                hashIndex_.erase(it);
+                return;
+            }
+        }
     }
 
 private:
-    int capacity_;     // 缓存容量
+    std::atomic<int> capacity_;  // 缓存容量，可由 setCapacity 调整
     NodeMap nodeMap_;  // key -> Node
-    std::mutex mutex_;
+    Mutex mutex_;
     NodePtr dummyHead_;  // 虚拟头结点
     NodePtr dummyTail_;
+    std::shared_ptr<KBloomAdmissionFilter> admissionFilter_;  // 准入过滤器，为空表示全部准入
+    KLruPromotion promotion_ = KLruPromotion::Eager;         // 命中时的提升方式
+    int64_t promotionWindow_ = 0;                            // Throttled 模式的提升间隔（steady_clock 刻度）
+    bool hashIndexEnabled_ = false;
+    HashIndex hashIndex_;  // key哈希 -> Node，仅在 enableHashIndex 后维护
+    Alloc alloc_;          // 结点分配器
+    KBudgetMeter<Key, Value> meter_;  // 内存预算的计费，未加入预算时不计费
+    uint64_t lastVersion_ = 0;        // 最近分配的版本号
+    uint64_t versionStride_ = 1;      // 相邻两个版本号的间隔，见 setVersionSpace
 };
 
 // LRU优化：Lru-k版本。 通过继承的方式进行再优化
@@ -194,27 +663,47 @@ private:
 };
 
 // lru优化：对lru进行分片，提高高并发使用的性能
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = KDefaultAlloc, typename Mutex = std::mutex>
 class KHashLruCaches {
 public:
-    KHashLruCaches(size_t capacity, int sliceNum)
-        : capacity_(capacity), sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency()) {
-        size_t sliceSize = std::ceil(capacity / static_cast<double>(sliceNum_));  // 获取每个分片的大小
-        for (int i = 0; i < sliceNum_; ++i) {
-            lruSliceCaches_.emplace_back(new KLruCache<Key, Value>(sliceSize));
-        }
+    using SliceType = KLruCache<Key, Value, Alloc, Mutex>;
+    using Shards = KReshardableSlices<Key, Value, SliceType>;
+
+    KHashLruCaches(size_t capacity, int sliceNum, const Alloc& alloc = Alloc())
+        : KHashLruCaches(capacity, sliceNum, [alloc](int) { return alloc; }) {}
+
+    // sliceAllocator(i) 返回第 i 个分片使用的分配器，例如每个分片一个独立的 memory_resource；
+    // 调用 reshard 扩容时还会用它为新增的分片创建分配器
+    KHashLruCaches(size_t capacity, int sliceNum, const std::function<Alloc(int)>& sliceAllocator)
+        : shards_(capacity, sliceNum, [sliceAllocator](int i, size_t sliceSize) {
+              auto* slice = new SliceType(sliceSize, sliceAllocator(i));
+              slice->setVersionSpace(i, Shards::kMaxSlices);  // 各分片的版本号互不相同
+              return slice;
+          }) {
+        shards_.setIndexSeeder([](SliceType& slice, uint64_t seed) { slice.setHashSeed(seed); });
     }
 
     void put(Key key, Value value) {
-        // 获取key的hash值，并计算出对应的分片索引
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->put(key, value);
+        // 扫描流量：不进入缓存或插入到淘汰端，保护常驻的热点数据
+        bool scan = scanDetector_ && scanDetector_->observe(key);
+        bool bypass = scan && scanDetector_->policy() == KScanPolicy::Bypass;
+        shards_.write(key, [&](SliceType& slice) -> bool {
+            if (bypass) return slice.replace(key, value);  // 不存在时没有写入，迁移中由源分片更新
+            if (scan) {
+                slice.putCold(key, value);
+            } else {
+                slice.put(key, value);
+            }
+            return true;
+        });
     }
 
     bool get(Key key, Value& value) {
-        // 获取key的hash值，并计算出对应的分片索引
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->get(key, value);
+        // 扫描命中时不提升，避免把扫描到的数据当作热点
+        bool scan = scanDetector_ && scanDetector_->observe(key);
+        return shards_.read(key, value, [&](SliceType& slice, Value& out) {
+            return scan ? slice.peek(key, out) : slice.get(key, out);
+        });
     }
 
     Value get(Key key) {
@@ -223,17 +712,198 @@ public:
         return value;
     }
 
+    bool remove(Key key) { return shards_.remove(key); }
+
+    // 查询并取得元素的版本号 | 未命中时 version 为 0 并返回false，见 KLruCache::getWithVersion
+    bool getWithVersion(Key key, Value& value, uint64_t& version) {
+        version = 0;
+        return shards_.read(key, value, [&](SliceType& slice, Value& out) {
+            return slice.getWithVersion(key, out, version);
+        });
+    }
+
+    // 比较并写入：元素的版本号等于 expected（为 0 表示元素不存在）时写入，比较与写入在分片的一次加锁内完成 |
+    // 写入时返回true。版本号在所有分片之间不重复；元素被迁移到其他分片时会得到新的版本号，
+    // 调整分片期间的条件写入可能多失败一次，乐观更新的调用方重新 getWithVersion 即可：
+    //     do { found = cache.getWithVersion(key, value, version); ... } while (!cache.putIfVersion(key, next, version));
+    bool putIfVersion(Key key, Value value, uint64_t expected) {
+        return shards_.writeIf(
+            key, [&](SliceType& slice) { return slice.versionOf(key) != 0; },
+            [&](SliceType& slice, auto valid) { return slice.putIfVersion(key, value, expected, valid); });
+    }
+
+    void purge() {
+        shards_.removeEverywhere([this](const typename Shards::Route&) {
+            shards_.forEachSlice([](SliceType& slice) { slice.purge(); });
+            return size_t(0);
+        });
+    }
+
+    // 在线调整分片数：元素在后台逐批迁移到新的分片，期间读写照常进行，见 KReshardableSlices |
+    // 上一次调整尚未完成时返回false
+    bool reshard(int sliceNum) { return shards_.reshard(sliceNum); }
+
+    // 是否正在迁移
+    bool resharding() const { return shards_.resharding(); }
+
+    // 等待正在进行的调整完成
+    void waitForReshard() { shards_.waitForReshard(); }
+
+    int sliceNum() const { return shards_.sliceNum(); }
+
+    // 调整总容量（例如在内存压力下收缩），超出的元素按淘汰顺序移除，见 KReshardableSlices::setCapacity
+    void setCapacity(size_t capacity) { shards_.setCapacity(capacity); }
+
+    size_t capacity() const { return shards_.capacity(); }
+
+    // 分片选择与各分片内部的哈希表改用带种子的哈希（KSeededHash.h），分片选择按新的种子在后台重新分布，
+    // 各分片的哈希表由迁移线程在各自的锁内重建，倾斜检测触发的换种子同样如此。种子为 0 时恢复 std::hash |
+    // 正在调整分片时返回false
+    bool setHashSeed(uint64_t seed = randomSeed()) { return shards_.reseed(seed); }
+
+    uint64_t hashSeed() const { return shards_.seed(); }
+
+    // 开启负载倾斜检测：某个分片的写入次数超过平均值的 threshold 倍时自动换一个随机种子重新分布，
+    // 见 KReshardableSlices::enableSkewDetection
+    void enableSkewDetection(double threshold = 2.0, size_t window = 1 << 16) {
+        shards_.enableSkewDetection(threshold, window);
+    }
+
+    // 倾斜检测触发的换种子次数
+    size_t skewReseeds() const { return shards_.skewReseeds(); }
+
+    // 设置扫描检测器（应在开始使用缓存之前设置）：被识别为扫描的访问按检测器的策略绕过或冷插入；传入空指针关闭
+    void setScanDetector(std::shared_ptr<KScanDetector<Key>> detector) { scanDetector_ = std::move(detector); }
+
+    // 设置所有分片命中时的提升方式，见 KLruCache::setPromotion
+    void setPromotion(KLruPromotion promotion, std::chrono::nanoseconds window = std::chrono::milliseconds(1)) {
+        shards_.configure("promotion", [promotion, window](SliceType& slice) { slice.setPromotion(promotion, window); });
+    }
+
+    // 所有分片共享同一个准入过滤器，见 KLruCache::setAdmissionFilter
+    void setAdmissionFilter(std::shared_ptr<KBloomAdmissionFilter> filter) {
+        shards_.configure("admission", [filter](SliceType& slice) { slice.setAdmissionFilter(filter); });
+    }
+
+    // 所有分片以同一个名字加入内存预算，各自计费与淘汰，统计时合并，见 KLruCache::setMemoryBudget
+    void setMemoryBudget(std::shared_ptr<KCacheBudget> budget, const std::string& name = "",
+                         typename SliceType::EntryBytes entryBytes = nullptr) {
+        shards_.configure("budget", [budget, name, entryBytes](SliceType& slice) {
+            slice.setMemoryBudget(budget, name, entryBytes);
+        });
+    }
+
+    // 开启所有分片的 key 哈希索引，见 KLruCache::enableHashIndex
+    void enableHashIndex() {
+        shards_.configure("hashIndex", [](SliceType& slice) { slice.enableHashIndex(); });
+    }
+
+    // 每个分片各取最新的 limit / sliceNum 个元素追加到 out，用于提取热点数据 | 返回复制的元素个数
+    size_t collectRecent(size_t limit, std::vector<std::pair<Key, Value>>& out) {
+        size_t perSlice = (limit + sliceNum() - 1) / sliceNum();
+        size_t collected = 0;
+        shards_.forEachSlice([&](SliceType& slice) { collected += slice.collectRecent(perSlice, out); });
+        return collected;
+    }
+
+    // 按 key 的哈希值（KLruCache::keyHash）批量删除：先按分片分组，每个分片只加一次锁 | 返回删除的元素个数。
+    // 分片哈希带种子时无法由 keyHash 算出分片，改为在所有分片上删除
+    size_t invalidateHashes(const uint64_t* hashes, size_t count) {
+        return shards_.removeEverywhere([&](const typename Shards::Route& route) {
+            size_t removed = 0;
+            if (!shards_.unseeded(route)) {
+                shards_.forEachSlice([&](SliceType& slice) { removed += slice.removeByHashes(hashes, count); });
+                return removed;
+            }
+            // 迁移中元素可能还在源分片：先删源分片，元素只会从源分片移向目标分片
+            if (route.migrating()) removed += invalidateHashes(hashes, count, route.from());
+            return removed + invalidateHashes(hashes, count, route.to());
+        });
+    }
+
+    // 批量查询：先按分片分组，每个分片只加一次锁 | 返回命中数
+    size_t getBatch(const Key* keys, size_t count, Value* values, bool* found) {
+        auto route = shards_.route();
+        if (route.migrating()) return getEach(keys, count, values, found);
+
+        std::vector<size_t> order, offsets;
+        groupBySlice(keys, count, route, order, offsets);
+        size_t hits = 0;
+        for (int i = 0; i < route.to(); ++i) {
+            size_t n = offsets[i + 1] - offsets[i];
+            if (n > 0) hits += shards_.slice(i).getBatch(keys, order.data() + offsets[i], n, values, found);
+        }
+        if (!shards_.changedSince(route)) return hits;
+        // 查询期间开始了迁移：未命中的 key 可能已被移走，逐个按新的路由重查
+        for (size_t i = 0; i < count; ++i) {
+            if (!found[i] && get(keys[i], values[i])) {
+                found[i] = true;
+                ++hits;
+            }
+        }
+        return hits;
+    }
+
+    // 批量写入：先按分片分组，每个分片只加一次锁（同一个key的多次写入保持原有顺序）
+    void putBatch(const Key* keys, const Value* values, size_t count) {
+        auto route = shards_.route();
+        if (!route.migrating()) {
+            std::vector<size_t> order, offsets;
+            groupBySlice(keys, count, route, order, offsets);
+            for (int i = 0; i < route.to(); ++i) {
+                size_t n = offsets[i + 1] - offsets[i];
+                if (n > 0) shards_.slice(i).putBatch(keys, values, order.data() + offsets[i], n);
+            }
+            if (!shards_.changedSince(route)) return;
+        }
+        // 迁移中，或写入期间开始了迁移：逐个按当前路由写入
+        for (size_t i = 0; i < count; ++i) {
+            shards_.write(keys[i], [&](SliceType& slice) { slice.put(keys[i], values[i]); });
+        }
+    }
+
 private:
-    // 将key转换为对应hash值
-    size_t Hash(Key key) {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+    size_t invalidateHashes(const uint64_t* hashes, size_t count, int sliceNum) {
+        std::vector<std::vector<uint64_t>> groups(sliceNum);
+        for (size_t i = 0; i < count; ++i) {
+            groups[Shards::indexOf(hashes[i], sliceNum)].push_back(hashes[i]);
+        }
+        size_t removed = 0;
+        for (int i = 0; i < sliceNum; ++i) {
+            if (!groups[i].empty()) removed += shards_.slice(i).removeByHashes(groups[i].data(), groups[i].size());
+        }
+        return removed;
+    }
+
+    size_t getEach(const Key* keys, size_t count, Value* values, bool* found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            found[i] = get(keys[i], values[i]);
+            hits += found[i];
+        }
+        return hits;
+    }
+
+    // 计数排序：order[offsets[i]..offsets[i+1]) 为落在第i个分片的key下标，分片内保持原有顺序
+    void groupBySlice(const Key* keys, size_t count, const typename Shards::Route& route, std::vector<size_t>& order,
+                      std::vector<size_t>& offsets) {
+        int sliceNum = route.to();
+        std::vector<int> sliceOf(count);
+        offsets.assign(sliceNum + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            sliceOf[i] = shards_.sliceOf(keys[i], route);
+            ++offsets[sliceOf[i] + 1];
+        }
+        for (int i = 0; i < sliceNum; ++i) offsets[i + 1] += offsets[i];
+
+        order.resize(count);
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < count; ++i) order[next[sliceOf[i]]++] = i;
     }
 
 private:
-    size_t capacity_;                                                     // 总容量
-    int sliceNum_;                                                        // 切片数量
-    std::vector<std::unique_ptr<KLruCache<Key, Value>>> lruSliceCaches_;  // 切片LRU缓存
+    Shards shards_;                                      // 切片LRU缓存，可在线调整分片数
+    std::shared_ptr<KScanDetector<Key>> scanDetector_;  // 扫描检测器，为空表示不检测
 };
 
-}  // namespace KamaCache
\ No newline at end of file
+}  // namespace KamaCache
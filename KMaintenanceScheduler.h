@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace KamaCache {
+
+// 维护任务调度器：一个后台线程按各自的周期执行登记的任务（刷新、老化等），多个缓存可以共享同一个调度器。
+// 任务在调度线程中串行执行，应当尽快返回，耗时的工作交给专门的线程池
+class KMaintenanceScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    KMaintenanceScheduler() : thread_([this] { run(); }) {}
+
+    ~KMaintenanceScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cond_.notify_all();
+        thread_.join();
+    }
+
+    // 登记一个周期任务，首次在一个周期后执行 | 返回任务编号
+    uint64_t addTask(std::function<void()> task, std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t id = nextId_++;
+        tasks_[id] = Task{std::move(task), interval, Clock::now() + interval};
+        cond_.notify_all();
+        return id;
+    }
+
+    // 注销任务，任务正在执行时等待其结束；之后任务不会再被调用
+    void removeTask(uint64_t id) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [&] { return running_ != id; });
+        tasks_.erase(id);
+    }
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        std::chrono::milliseconds interval;
+        Clock::time_point next;  // 下次执行时间
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            Clock::time_point wakeup = Clock::time_point::max();
+            uint64_t due = 0;
+            for (auto& entry : tasks_) {
+                if (entry.second.next < wakeup) {
+                    wakeup = entry.second.next;
+                    due = entry.first;
+                }
+            }
+            if (due == 0 || Clock::now() < wakeup) {
+                if (due == 0) {
+                    cond_.wait(lock);
+                } else {
+                    cond_.wait_until(lock, wakeup);
+                }
+                continue;
+            }
+
+            Task& task = tasks_[due];
+            task.next = Clock::now() + task.interval;
+            std::function<void()> fn = task.fn;
+            running_ = due;
+            lock.unlock();
+            fn();
+            lock.lock();
+            running_ = 0;
+            cond_.notify_all();
+        }
+    }
+
+private:
+    std::map<uint64_t, Task> tasks_;
+    uint64_t nextId_ = 1;
+    uint64_t running_ = 0;  // 正在执行的任务编号，0 表示没有
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread thread_;  // 最后构造，启动时其余成员已经初始化
+};
+
+}  // namespace KamaCache
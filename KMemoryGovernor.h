@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "KMaintenanceScheduler.h"
+
+namespace KamaCache {
+
+struct KMemoryGovernorOptions {
+    std::string pressurePath = "/proc/pressure/memory";  // PSI 文件，不存在（内核未开启 PSI）时只看 cgroup 用量
+    std::string cgroupPath;         // cgroup v2 目录（含 memory.current、memory.max），为空时由 /proc/self/cgroup 推断
+    double somePressureHigh = 10;   // some avg10（%，至少一个任务因内存等待的时间占比）不低于该值时收缩
+    double fullPressureHigh = 1;    // full avg10（%，所有任务都在等待内存的时间占比）不低于该值时收缩
+    double pressureLow = 1;         // some avg10 低于该值、且用量低于 usageLow 时才算没有压力
+    double usageHigh = 0.9;         // memory.current / memory.max 不低于该值时收缩
+    double usageLow = 0.8;          // 用量比例低于该值时才算没有压力
+    double shrinkFactor = 0.75;     // 每次收缩把所有缓存的容量乘以该系数
+    // 两次收缩的最小间隔：PSI avg10 是 10 秒的滑动平均，压力过去后仍会偏高一段时间，
+    // 收缩释放的内存也不会立即反映到 memory.current，间隔太短会因同一次压力连续收缩到 minScale
+    std::chrono::milliseconds shrinkInterval = std::chrono::seconds(10);
+    double growStep = 0.1;          // 每次扩回增加基准容量的该比例
+    double minScale = 0.1;          // 容量不低于基准容量的该比例
+    int calmPolls = 3;              // 连续这么多次没有压力后才开始扩回，避免在阈值附近来回调整
+};
+
+// 一次采样的内存压力与 cgroup 用量
+struct KMemorySample {
+    bool hasPressure = false;  // 读到了 PSI
+    double someAvg10 = 0;
+    double fullAvg10 = 0;
+    bool hasLimit = false;     // cgroup 设置了内存上限（memory.max 不为 "max"）
+    uint64_t current = 0;      // memory.current 减去 memory.stat 中可直接回收的 inactive_file，字节
+    uint64_t max = 0;          // memory.max，字节
+};
+
+// 内存压力调节器：定期读取 /proc/pressure/memory 与 cgroup v2 的 memory.current、memory.max、memory.stat，
+// 有压力时按同一比例收缩所有登记的缓存，压力消失一段时间后逐步扩回基准容量，避免缓存挤占应用所需的内存导致 OOM。
+// 调节只通过登记时给出的 resize 回调完成（如分片缓存的 setCapacity），被收缩掉的元素由缓存按淘汰顺序移除。
+// 可以挂到 KMaintenanceScheduler 上定期执行，也可以由调用方自行调用 poll；测试时把路径指向构造的文件，
+// 或直接把样本交给 apply。resize 回调在调节器的锁内调用，不能再调用调节器
+class KMemoryGovernor {
+public:
+    enum class Action { Hold, Shrink, Grow };
+    using Clock = std::chrono::steady_clock;
+
+    explicit KMemoryGovernor(KMemoryGovernorOptions options = KMemoryGovernorOptions()) : options_(std::move(options)) {
+        if (options_.cgroupPath.empty()) options_.cgroupPath = currentCgroupPath();
+    }
+
+    ~KMemoryGovernor() { detach(); }
+
+    KMemoryGovernor(const KMemoryGovernor&) = delete;
+    KMemoryGovernor& operator=(const KMemoryGovernor&) = delete;
+
+    // 登记一个缓存：baseCapacity 为没有压力时的容量，resize(capacity) 调整容量。已经处于收缩状态时立即按当前比例收缩 |
+    // 返回登记编号
+    uint64_t add(size_t baseCapacity, std::function<void(size_t)> resize) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t id = nextId_++;
+        Entry& entry = entries_[id];
+        entry.base = baseCapacity;
+        entry.applied = baseCapacity;
+        entry.resize = std::move(resize);
+        resizeEntry(entry);
+        return id;
+    }
+
+    // 登记提供 capacity() 与 setCapacity() 的缓存（KHashLruCaches、KHashLfuCache、KLruCache 等），以当前容量为基准
+    template <typename Cache>
+    uint64_t add(Cache& cache) {
+        return add(cache.capacity(), [&cache](size_t capacity) { cache.setCapacity(capacity); });
+    }
+
+    // 注销缓存，容量保持注销时的大小
+    void remove(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.erase(id);
+    }
+
+    // 读取一次压力与用量，按需收缩或扩回
+    Action poll(Clock::time_point now = Clock::now()) { return apply(sample(), now); }
+
+    // 按给定的样本收缩或扩回，now 用于限制收缩的频率（见 shrinkInterval）
+    Action apply(const KMemorySample& sample, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        double usage = sample.hasLimit && sample.max > 0 ? static_cast<double>(sample.current) / sample.max : 0;
+        bool pressured = (sample.hasPressure && (sample.someAvg10 >= options_.somePressureHigh ||
+                                                 sample.fullAvg10 >= options_.fullPressureHigh)) ||
+                         (sample.hasLimit && usage >= options_.usageHigh);
+        bool calm = (!sample.hasPressure || sample.someAvg10 < options_.pressureLow) &&
+                    (!sample.hasLimit || usage < options_.usageLow);
+
+        Action action = Action::Hold;
+        if (pressured) {
+            calmPolls_ = 0;
+            bool cooledDown = !shrunk_ || now - lastShrink_ >= options_.shrinkInterval;
+            if (scale_ > options_.minScale && cooledDown) {
+                scale_ = std::max(options_.minScale, scale_ * options_.shrinkFactor);
+                lastShrink_ = now;
+                shrunk_ = true;
+                action = Action::Shrink;
+            }
+        } else if (!calm) {
+            calmPolls_ = 0;
+        } else if (++calmPolls_ >= options_.calmPolls && scale_ < 1) {
+            scale_ = std::min(1.0, scale_ + options_.growStep);
+            action = Action::Grow;
+        }
+        if (action != Action::Hold) {
+            for (auto& entry : entries_) resizeEntry(entry.second);
+        }
+        return action;
+    }
+
+    // 读取当前的压力与用量，读不到的部分标记为不可用
+    KMemorySample sample() const {
+        KMemorySample sample;
+        std::ifstream pressure(options_.pressurePath);
+        if (pressure) sample.hasPressure = parsePressure(pressure, sample);
+        uint64_t max = 0;
+        if (readLimit(options_.cgroupPath + "/memory.max", max) &&
+            readNumber(options_.cgroupPath + "/memory.current", sample.current)) {
+            sample.hasLimit = true;
+            sample.max = max;
+            // memory.current 包含页缓存，其中 inactive_file 在内存紧张时可以直接回收，不算压力
+            sample.current -= std::min(sample.current, readStat(options_.cgroupPath + "/memory.stat", "inactive_file"));
+        }
+        return sample;
+    }
+
+    // 当前容量相对基准容量的比例
+    double scale() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return scale_;
+    }
+
+    const KMemoryGovernorOptions& options() const { return options_; }
+
+    // 挂到维护调度器上，每 interval 调用一次 poll。调度器需要比调节器活得更久，或者先调用 detach
+    void attach(KMaintenanceScheduler& scheduler, std::chrono::milliseconds interval = std::chrono::seconds(1)) {
+        detach();
+        scheduler_ = &scheduler;
+        taskId_ = scheduler.addTask([this] { poll(); }, interval);
+    }
+
+    void detach() {
+        if (!scheduler_) return;
+        scheduler_->removeTask(taskId_);
+        scheduler_ = nullptr;
+    }
+
+    // 解析 PSI 文件的 some、full 两行（"some avg10=1.23 avg60=... total=..."），只取 avg10 | 至少解析出 some 行时返回true
+    static bool parsePressure(std::istream& in, KMemorySample& sample) {
+        bool parsed = false;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string kind, field;
+            fields >> kind;
+            while (fields >> field) {
+                if (field.compare(0, 6, "avg10=") != 0) continue;
+                double value = std::strtod(field.c_str() + 6, nullptr);
+                if (kind == "some") {
+                    sample.someAvg10 = value;
+                    parsed = true;
+                } else if (kind == "full") {
+                    sample.fullAvg10 = value;
+                }
+            }
+        }
+        return parsed;
+    }
+
+private:
+    struct Entry {
+        size_t base;                          // 基准容量
+        size_t applied;                       // 最近一次设置的容量
+        std::function<void(size_t)> resize;
+    };
+
+    // 持有 mutex_ 时调用：按当前比例调整一个缓存，容量没有变化时不调用
+    void resizeEntry(Entry& entry) {
+        if (entry.base == 0) return;
+        size_t target = std::max<size_t>(1, static_cast<size_t>(std::llround(entry.base * scale_)));
+        if (target == entry.applied) return;
+        entry.applied = target;
+        entry.resize(target);
+    }
+
+    static bool readNumber(const std::string& path, uint64_t& value) {
+        std::ifstream in(path);
+        return static_cast<bool>(in >> value);
+    }
+
+    // memory.stat 中 "name value" 一行的值，没有该行时为 0
+    static uint64_t readStat(const std::string& path, const std::string& name) {
+        std::ifstream in(path);
+        std::string key;
+        uint64_t value = 0;
+        while (in >> key >> value) {
+            if (key == name) return value;
+        }
+        return 0;
+    }
+
+    // memory.max 为 "max" 表示没有上限
+    static bool readLimit(const std::string& path, uint64_t& value) {
+        std::ifstream in(path);
+        std::string text;
+        if (!(in >> text) || text == "max") return false;
+        value = std::strtoull(text.c_str(), nullptr, 10);
+        return value > 0;
+    }
+
+    // 本进程所在的 cgroup v2 目录：/proc/self/cgroup 中 "0::<path>" 一行
+    static std::string currentCgroupPath() {
+        std::ifstream in("/proc/self/cgroup");
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 3, "0::") == 0) {
+                std::string path = line.substr(3);
+                return path == "/" ? "/sys/fs/cgroup" : "/sys/fs/cgroup" + path;
+            }
+        }
+        return "/sys/fs/cgroup";
+    }
+
+private:
+    KMemoryGovernorOptions options_;
+    std::map<uint64_t, Entry> entries_;  // 登记的缓存
+    uint64_t nextId_ = 1;
+    double scale_ = 1;                   // 当前容量相对基准容量的比例
+    int calmPolls_ = 0;                  // 连续没有压力的次数
+    Clock::time_point lastShrink_{};     // 最近一次收缩的时间
+    bool shrunk_ = false;                // 是否收缩过
+    mutable std::mutex mutex_;
+    KMaintenanceScheduler* scheduler_ = nullptr;
+    uint64_t taskId_ = 0;
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "KFrequencySketch.h"
+#include "KLruCache.h"
+#include "KMaintenanceScheduler.h"
+
+namespace KamaCache {
+
+// 有界的后台任务线程池：队列满时拒绝新任务而不是阻塞调用者
+class KRefreshExecutor {
+public:
+    KRefreshExecutor(int threads, size_t queueCapacity) : queueCapacity_(queueCapacity) {
+        for (int i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    // 停止时丢弃尚未执行的任务
+    ~KRefreshExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            tasks_.clear();
+        }
+        cond_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    // 提交任务 | 队列已满返回false
+    bool trySubmit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || tasks_.size() >= queueCapacity_) return false;
+            tasks_.push_back(std::move(task));
+        }
+        cond_.notify_one();
+        return true;
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (stopping_) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+private:
+    size_t queueCapacity_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stopping_ = false;
+};
+
+// 带过期时间的读穿透缓存：未命中时调用 loader 加载，同一个 key 同一时间只有一次加载（single-flight）。
+// 为避免热点 key 同时过期引发的回源风暴：
+//   1. 提前刷新（XFetch）：每次命中以概率 P(now - delta * beta * ln(rand) >= expiry) 触发后台刷新，
+//      delta 为该 key 上次加载实际耗时，越接近过期、加载越慢，提前刷新的概率越高
+//   2. 过期后再过 staleWindow 之内仍返回旧值，同时触发一次后台刷新（stale-while-revalidate）
+// 只有超过 staleWindow 的元素才会同步加载。
+// 另外可以开启提前加载（enableRefreshAhead）：访问频率超过阈值的热点 key 在过期前由维护任务主动刷新，热点数据不会出现未命中。
+// Mutex 为分片缓存、进行中的加载表与热点 key 集合的锁的类型，见 KLock.h；
+// 刷新线程池的任务队列与条件变量配合使用，固定为 std::mutex
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KRefreshingCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Loader = std::function<Value(const Key&)>;
+
+    // beta 越大越早刷新，为 0 时关闭提前刷新；staleWindow 为 0 时关闭 stale-while-revalidate
+    KRefreshingCache(size_t capacity, int sliceNum, Loader loader, std::chrono::milliseconds ttl, double beta = 1.0,
+                     std::chrono::milliseconds staleWindow = std::chrono::milliseconds(0), int refreshThreads = 1,
+                     size_t refreshQueueCapacity = 1024)
+        : capacity_(capacity),
+          cache_(capacity, sliceNum),
+          loader_(std::move(loader)),
+          ttl_(ttl),
+          beta_(beta),
+          staleWindow_(staleWindow),
+          executor_(refreshThreads, refreshQueueCapacity) {}
+
+    ~KRefreshingCache() {
+        if (scheduler_) scheduler_->removeTask(maintenanceTask_);
+    }
+
+    // 开启提前加载：用频率草图统计访问频率，估计值达到 threshold（1..15）的 key 记为热点，
+    // 调度器每 interval 检查一次热点 key，剩余有效期不足 (1 - aheadFraction) * ttl 的交给刷新线程池重新加载。
+    // maxHotKeys 限制同时跟踪的热点 key 个数，已满时新的热点 key 由维护任务重试登记，比跟踪中最冷的 key 更热时替换它。设置整体通过原子指针发布，可以在其他线程访问缓存时调用，但只能调用一次
+    void enableRefreshAhead(std::shared_ptr<KMaintenanceScheduler> scheduler, int threshold, double aheadFraction = 0.8,
+                            std::chrono::milliseconds interval = std::chrono::milliseconds(10),
+                            size_t maxHotKeys = 1024) {
+        if (aheadOwner_) throw std::logic_error("KRefreshingCache::enableRefreshAhead called twice");
+        aheadOwner_.reset(new RefreshAhead{KFrequencySketch(capacity_), threshold, maxHotKeys,
+                                           std::chrono::duration_cast<Clock::duration>(ttl_ * (1.0 - aheadFraction))});
+        ahead_.store(aheadOwner_.get(), std::memory_order_release);
+        scheduler_ = std::move(scheduler);
+        maintenanceTask_ = scheduler_->addTask([this] { refreshHotKeys(); }, interval);
+    }
+
+    // 读穿透查询：必要时同步加载，loader 抛出的异常会传递给调用者
+    Value get(const Key& key) {
+        recordAccess(key);
+        EntryPtr entry;
+        if (cache_.get(key, entry)) {
+            Clock::time_point now = Clock::now();
+            if (now < entry->expiry) {
+                if (shouldRefreshEarly(*entry, now)) scheduleRefresh(key);
+                return entry->value;
+            }
+            if (now < entry->expiry + staleWindow_) {
+                staleHits_.fetch_add(1, std::memory_order_relaxed);
+                scheduleRefresh(key);
+                return entry->value;
+            }
+        }
+        return load(key)->value;
+    }
+
+    // 只查询不加载（仍可能触发后台刷新）| 不存在或已超过 staleWindow 返回false
+    bool getIfPresent(const Key& key, Value& value) {
+        recordAccess(key);
+        EntryPtr entry;
+        if (!cache_.get(key, entry)) return false;
+        Clock::time_point now = Clock::now();
+        if (now >= entry->expiry + staleWindow_) return false;
+        if (now >= entry->expiry) {
+            staleHits_.fetch_add(1, std::memory_order_relaxed);
+            scheduleRefresh(key);
+        } else if (shouldRefreshEarly(*entry, now)) {
+            scheduleRefresh(key);
+        }
+        value = entry->value;
+        return true;
+    }
+
+    // 直接写入，加载耗时沿用旧值
+    void put(const Key& key, const Value& value) {
+        EntryPtr old;
+        Clock::duration delta = cache_.get(key, old) ? old->delta : Clock::duration::zero();
+        cache_.put(key, std::make_shared<const Entry>(Entry{value, Clock::now() + ttl_, delta}));
+    }
+
+    void invalidate(const Key& key) { cache_.remove(key); }
+
+    size_t loads() const { return loads_.load(std::memory_order_relaxed); }          // 调用 loader 的次数
+    size_t refreshes() const { return refreshes_.load(std::memory_order_relaxed); }  // 其中后台刷新的次数
+    size_t staleHits() const { return staleHits_.load(std::memory_order_relaxed); }  // 返回过期旧值的次数
+    size_t syncLoads() const { return loads() - refreshes(); }                       // 调用者同步等待加载的次数
+
+private:
+    struct Entry {
+        Value value;
+        Clock::time_point expiry;  // 过期时间
+        Clock::duration delta;     // 上次加载耗时
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    // 提前加载的设置，enableRefreshAhead 一次性构造后发布
+    struct RefreshAhead {
+        KFrequencySketch sketch;  // 访问频率
+        int threshold;            // 估计值达到它即为热点
+        size_t maxHotKeys;
+        Clock::duration margin;   // 剩余有效期小于它时提前加载
+    };
+
+    bool shouldRefreshEarly(const Entry& entry, Clock::time_point now) const {
+        if (beta_ <= 0 || entry.delta == Clock::duration::zero()) return false;
+        thread_local std::mt19937_64 gen(std::random_device{}());
+        // (0, 1] 上的均匀分布，-ln(u) 服从均值为 1 的指数分布
+        double u = 1.0 - std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        auto gap = std::chrono::duration<double>(entry.delta) * (beta_ * -std::log(u));
+        return now + std::chrono::duration_cast<Clock::duration>(gap) >= entry.expiry;
+    }
+
+    // 同步加载：已有加载（包括后台刷新）进行中时等待其结果
+    EntryPtr load(const Key& key) {
+        std::promise<EntryPtr> promise;
+        std::shared_future<EntryPtr> future;
+        {
+            std::lock_guard<Mutex> lock(inFlightMutex_);
+            auto it = inFlight_.find(key);
+            if (it != inFlight_.end()) {
+                future = it->second;
+            } else {
+                inFlight_.emplace(key, promise.get_future().share());
+            }
+        }
+        if (future.valid()) {
+            // 后台刷新未能提交时结果为空，重新发起加载
+            EntryPtr entry = future.get();
+            return entry ? entry : load(key);
+        }
+
+        try {
+            EntryPtr entry = loadEntry(key);
+            promise.set_value(entry);
+            finishFlight(key);
+            return entry;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            finishFlight(key);
+            throw;
+        }
+    }
+
+    // 后台刷新：同一个 key 已有加载进行中或队列已满时不提交
+    void scheduleRefresh(const Key& key) {
+        auto promise = std::make_shared<std::promise<EntryPtr>>();
+        {
+            std::lock_guard<Mutex> lock(inFlightMutex_);
+            if (inFlight_.count(key)) return;
+            inFlight_.emplace(key, promise->get_future().share());
+        }
+        bool submitted = executor_.trySubmit([this, key, promise] {
+            try {
+                promise->set_value(loadEntry(key));
+                refreshes_.fetch_add(1, std::memory_order_relaxed);
+            } catch (...) {
+                // 刷新失败时保留旧值，等待者收到异常
+                promise->set_exception(std::current_exception());
+            }
+            finishFlight(key);
+        });
+        if (!submitted) {
+            promise->set_value(nullptr);
+            finishFlight(key);
+        }
+    }
+
+    EntryPtr loadEntry(const Key& key) {
+        Clock::time_point start = Clock::now();
+        Value value = loader_(key);
+        Clock::time_point end = Clock::now();
+        loads_.fetch_add(1, std::memory_order_relaxed);
+        auto entry = std::make_shared<const Entry>(Entry{std::move(value), end + ttl_, end - start});
+        cache_.put(key, entry);
+        return entry;
+    }
+
+    // 只有估计值从阈值以下跨过阈值的那次访问才加锁登记热点 key，已经是热点的 key 之后的访问不再争用 hotMutex_。
+    // 热点集合已满时记入候选集合，由维护任务在估计值保持在阈值以上期间重试，不会因为跨过阈值时恰好已满而一直漏掉
+    void recordAccess(const Key& key) {
+        RefreshAhead* ahead = ahead_.load(std::memory_order_acquire);
+        if (ahead == nullptr) return;
+        uint64_t hash = std::hash<Key>{}(key);
+        int before = ahead->sketch.estimate(hash);
+        ahead->sketch.increment(hash);
+        if (before >= ahead->threshold || ahead->sketch.estimate(hash) < ahead->threshold) return;
+        std::lock_guard<Mutex> lock(hotMutex_);
+        if (hotKeys_.size() < ahead->maxHotKeys) {
+            hotKeys_.insert(key);
+        } else if (candidates_.size() < ahead->maxHotKeys) {
+            candidates_.insert(key);
+        }
+    }
+
+    // 维护任务：刷新即将过期的热点 key，并移除频率已经降下来的 key（草图会周期性减半）
+    void refreshHotKeys() {
+        const RefreshAhead& ahead = *ahead_.load(std::memory_order_acquire);
+        std::vector<Key> keys;
+        {
+            std::lock_guard<Mutex> lock(hotMutex_);
+            std::vector<std::pair<int, Key>> tracked;  // 仍是热点的 key 及其估计值
+            for (auto it = hotKeys_.begin(); it != hotKeys_.end();) {
+                int estimate = ahead.sketch.estimate(std::hash<Key>{}(*it));
+                if (estimate < ahead.threshold) {
+                    it = hotKeys_.erase(it);
+                } else {
+                    tracked.emplace_back(estimate, *it++);
+                }
+            }
+            if (!candidates_.empty()) admitCandidates(ahead, tracked);
+            keys.assign(hotKeys_.begin(), hotKeys_.end());
+        }
+        Clock::time_point now = Clock::now();
+        for (const Key& key : keys) {
+            EntryPtr entry;
+            if (!cache_.get(key, entry) || entry->expiry - ahead.margin <= now) scheduleRefresh(key);
+        }
+    }
+
+    // 持有 hotMutex_ 时调用：重试登记候选 key。估计值已降到阈值以下的放弃；热点集合有空位时直接登记，
+    // 否则比跟踪中最冷的 key 更热时替换它，其余留待下一轮
+    void admitCandidates(const RefreshAhead& ahead, std::vector<std::pair<int, Key>>& tracked) {
+        std::sort(tracked.begin(), tracked.end(),
+                  [](const std::pair<int, Key>& a, const std::pair<int, Key>& b) { return a.first < b.first; });
+        size_t coldest = 0;
+        for (auto it = candidates_.begin(); it != candidates_.end();) {
+            int estimate = ahead.sketch.estimate(std::hash<Key>{}(*it));
+            if (estimate < ahead.threshold || hotKeys_.count(*it)) {
+                it = candidates_.erase(it);
+                continue;
+            }
+            if (hotKeys_.size() >= ahead.maxHotKeys) {
+                if (coldest == tracked.size() || tracked[coldest].first >= estimate) {
+                    ++it;
+                    continue;
+                }
+                hotKeys_.erase(tracked[coldest++].second);
+            }
+            hotKeys_.insert(*it);
+            it = candidates_.erase(it);
+        }
+    }
+
+    void finishFlight(const Key& key) {
+        std::lock_guard<Mutex> lock(inFlightMutex_);
+        inFlight_.erase(key);
+    }
+
+private:
+    size_t capacity_;                                            // 总容量
+    KHashLruCaches<Key, EntryPtr, KDefaultAlloc, Mutex> cache_;  // 存放 value 与过期信息
+    Loader loader_;                                              // 回源加载函数
+    Clock::duration ttl_;                                        // 有效期
+    double beta_;                                                // XFetch 的提前系数
+    Clock::duration staleWindow_;                                // 过期后仍可返回旧值的时长
+
+    Mutex inFlightMutex_;
+    std::unordered_map<Key, std::shared_future<EntryPtr>> inFlight_;  // 进行中的加载
+
+    std::atomic<size_t> loads_{0};
+    std::atomic<size_t> refreshes_{0};
+    std::atomic<size_t> staleHits_{0};
+
+    // 提前加载：设置与正在跟踪的热点 key
+    std::unique_ptr<RefreshAhead> aheadOwner_;
+    std::atomic<RefreshAhead*> ahead_{nullptr};  // 为空表示未开启提前加载
+    Mutex hotMutex_;
+    std::unordered_set<Key> hotKeys_;           // 正在跟踪的热点 key
+    std::unordered_set<Key> candidates_;        // 热点集合已满时跨过阈值的 key，最多 maxHotKeys 个
+    std::shared_ptr<KMaintenanceScheduler> scheduler_;
+    uint64_t maintenanceTask_ = 0;
+
+    KRefreshExecutor executor_;  // 最后构造、最先析构，保证后台任务结束时其余成员仍然有效
+};
+
+}  // namespace KamaCache
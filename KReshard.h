@@ -0,0 +1,442 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "KSeededHash.h"
+
+namespace KamaCache {
+
+// Jump Consistent Hash（Lamping & Veach）：把哈希值映射到 [0, buckets)。分片数从 n 变为 n+1 时只有约 1/(n+1) 的 key
+// 改变分片，并且都移入新增的分片；从 n 减为 n-1 时只有最后一个分片的 key 需要移走
+inline int jumpConsistentHash(uint64_t key, int buckets) {
+    int64_t b = -1, j = 0;
+    while (j < buckets) {
+        b = j;
+        key = key * 2862933555777941757ULL + 1;
+        j = static_cast<int64_t>((b + 1) * (static_cast<double>(1LL << 31) / static_cast<double>((key >> 33) + 1)));
+    }
+    return static_cast<int>(b);
+}
+
+// 可在线调整分片数与分片哈希种子的分片集合，由 KHashLruCaches、KHashLfuCache 持有。
+// key 位于 jumpConsistentHash(KSeededHash<Key>(seed)(key), 分片数) 号分片，种子为 0 时即 std::hash。
+// 路由状态（版本号、迁移源与目标的分片数及种子槽位）打包在一个原子变量中，读写路径只多一次原子读：
+//   - 稳定状态（源与目标相同）：操作完成后若发现版本号变化，说明迁移在操作期间开始，
+//     调用方按迁移中的路由重做一次，保证迁移线程不会漏掉这次写入
+//   - 迁移状态：写入目标分片并删除源分片中的旧值；读取先查目标分片，未命中再查源分片，元素只由迁移线程移动
+// 调整分片数（reshard）与更换种子（reseed）都按这种方式迁移：后台线程逐个分片快照需要移动的 key，
+// 按批从源分片取出、写入目标分片（已存在时不覆盖，目标分片中的值更新），全程不停止读写。
+// 读取与条件写入遇到取出与写入之间的在途批次时，等这一批写完再查，正在迁移的元素不会被当作不存在。
+// Slice 需要提供 remove、extract、putIfAbsent、collectKeys、setCapacity、purge
+template <typename Key, typename Value, typename Slice>
+class KReshardableSlices {
+public:
+    static constexpr int kMaxSlices = 1024;
+    static constexpr size_t kMigrationBatch = 256;  // 每批迁移的 key 个数，两批之间让出 CPU
+
+    // 版本号(30) | 源种子槽位(1) | 目标种子槽位(1) | 源分片数(16) | 目标分片数(16)
+    struct Route {
+        uint64_t word;
+
+        uint32_t version() const { return static_cast<uint32_t>(word >> 34); }
+        int fromSeedSlot() const { return static_cast<int>((word >> 33) & 1); }
+        int toSeedSlot() const { return static_cast<int>((word >> 32) & 1); }
+        int from() const { return static_cast<int>((word >> 16) & 0xffff); }
+        int to() const { return static_cast<int>(word & 0xffff); }
+        bool migrating() const { return from() != to() || fromSeedSlot() != toSeedSlot(); }
+    };
+
+    // factory(i, sliceCapacity) 创建第 i 个分片
+    KReshardableSlices(size_t capacity, int sliceNum, std::function<Slice*(int, size_t)> factory)
+        : capacity_(capacity), factory_(std::move(factory)), slices_(kMaxSlices) {
+        int count = std::clamp(sliceNum > 0 ? sliceNum : static_cast<int>(std::thread::hardware_concurrency()), 1,
+                               kMaxSlices);
+        for (int i = 0; i < count; ++i) slices_[i].reset(factory_(i, sliceCapacity(count)));
+        allocated_ = count;
+        route_.store(pack(0, 0, 0, count, count), std::memory_order_release);
+    }
+
+    ~KReshardableSlices() {
+        stop_.store(true, std::memory_order_relaxed);
+        if (migrator_.joinable()) migrator_.join();
+    }
+
+    Route route() const { return Route{route_.load(std::memory_order_acquire)}; }
+
+    // 读取 route 之后路由是否变化过
+    bool changedSince(const Route& route) const { return route_.load(std::memory_order_acquire) != route.word; }
+
+    Slice& slice(int index) { return *slices_[index]; }
+
+    // 种子为 0 时，key 按 std::hash<Key> 的结果 hash 位于 indexOf(hash, 分片数) 号分片
+    static int indexOf(uint64_t hash, int count) { return jumpConsistentHash(hash, count); }
+
+    // 按路由 r，key 所在（迁移中为迁入）的分片
+    int sliceOf(const Key& key, const Route& r) const { return indexOf(hashOf(key, r.toSeedSlot()), r.to()); }
+
+    // 按路由 r，迁移中 key 原来所在的分片
+    int sourceOf(const Key& key, const Route& r) const { return indexOf(hashOf(key, r.fromSeedSlot()), r.from()); }
+
+    // 路由 r 是否不带种子，此时可以由 std::hash<Key> 的结果直接算出分片
+    bool unseeded(const Route& r) const {
+        return seeds_[r.toSeedSlot()].load(std::memory_order_relaxed) == 0 &&
+               seeds_[r.fromSeedSlot()].load(std::memory_order_relaxed) == 0;
+    }
+
+    uint64_t seed() const { return seeds_[route().toSeedSlot()].load(std::memory_order_relaxed); }
+
+    int sliceNum() const { return route().to(); }
+
+    bool resharding() const { return route().migrating(); }
+
+    // 开始把分片数调整为 sliceNum，迁移在后台进行 | 上一次调整尚未完成或分片数不合法时返回 false
+    bool reshard(int sliceNum) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Route current = route();
+        if (current.migrating() || sliceNum < 1 || sliceNum > kMaxSlices) return false;
+        if (sliceNum == current.to()) return true;
+        startMigration(current, sliceNum, current.toSeedSlot());
+        return true;
+    }
+
+    // 开始把分片哈希的种子换为 seed（0 表示 std::hash），分片数不变，几乎所有元素都要迁移。
+    // 设置了 setIndexSeeder 时，迁移线程先用派生的种子重建各分片内部的哈希表 | 上一次调整尚未完成时返回 false
+    bool reseed(uint64_t seed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return reseedLocked(seed);
+    }
+
+    // 开启负载倾斜检测：各分片的写入次数中，最多的分片超过平均值的 threshold 倍时，换一个随机种子重新分布。
+    // 只统计写入：旁路缓存中写入基本对应未命中的不同 key，分布由哈希决定；读取集中在少数热点 key 时换种子也无法分散。
+    // 每 window 次写入评估一次；换种子后倾斜仍然存在，说明不是哈希造成的，之后的评估窗口翻倍，减少无效的迁移
+    void enableSkewDetection(double threshold = 2.0, size_t window = 1 << 16) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writeCounts_) writeCounts_.reset(new Counter[kMaxSlices]);
+        skewWindow_ = std::max<size_t>(window, kSkewCheckInterval);
+        skewThreshold_.store(threshold, std::memory_order_release);
+    }
+
+    // 设置分片内部哈希表的换种子方式：每次换种子（reseed 或倾斜检测触发）都用 wyhash64(seed, 1) 调用
+    // seeder(slice, 种子)，与分片选择的种子不同，分片内的 key 不再相关；种子为 0 时传入 0
+    void setIndexSeeder(std::function<void(Slice&, uint64_t)> seeder) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        indexSeeder_ = std::move(seeder);
+    }
+
+    // 负载倾斜检测触发的换种子次数
+    size_t skewReseeds() const { return skewReseeds_.load(std::memory_order_relaxed); }
+
+    // 调整总容量，按分片数平分，超出的元素由各分片按淘汰顺序移除。迁移中只记录新的容量，迁移结束时应用
+    void setCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_.store(capacity, std::memory_order_seq_cst);
+        Route r{route_.load(std::memory_order_seq_cst)};
+        if (r.migrating()) return;
+        for (int i = 0; i < r.to(); ++i) slices_[i]->setCapacity(sliceCapacity(r.to()));
+    }
+
+    size_t capacity() const { return capacity_.load(std::memory_order_relaxed); }
+
+    // 等待正在进行的调整完成
+    void waitForReshard() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (migrator_.joinable()) migrator_.join();
+    }
+
+    // 对所有已创建的分片应用一项设置，并记录下来应用到以后新建的分片；同名设置后来的覆盖先前的
+    void configure(const std::string& name, std::function<void(Slice&)> apply) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < allocated_; ++i) apply(*slices_[i]);
+        settings_[name] = std::move(apply);
+    }
+
+    // 对所有已创建的分片（包括缩容后空闲的分片）执行 f
+    template <typename F>
+    void forEachSlice(F f) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < allocated_; ++i) f(*slices_[i]);
+    }
+
+    // 读取：read(slice) 在 key 所在的分片上查询。迁移中目标分片未命中时再查源分片，
+    // 两者都未命中而期间有一批元素在途时，等这一批写完再查，不把正在迁移的元素当作不存在
+    template <typename Read>
+    bool read(const Key& key, Value& value, Read read) {
+        while (true) {
+            Route r = route();
+            if (!r.migrating()) {
+                if (read(slice(sliceOf(key, r)), value)) return true;
+                if (!changedSince(r)) return false;
+                continue;  // 未命中可能是因为 key 已被迁走，按新的路由重查
+            }
+            uint64_t batch = movingBatch_.load(std::memory_order_seq_cst);
+            Slice& target = slice(sliceOf(key, r));
+            if (read(target, value)) return true;
+            Slice& source = slice(sourceOf(key, r));
+            if (&source != &target && read(source, value)) return true;
+            if (!movedSince(batch)) return false;
+            waitForBatch(batch);
+        }
+    }
+
+    // 写入：write(slice) 在 key 所在的分片上写入。迁移中同时删除源分片中的旧值。
+    // write 也可以返回 bool，返回false表示没有写入（例如只更新已存在元素的 replace 在目标分片中找不到 key）：
+    // 此时 key 可能还在源分片，改为在源分片上执行同一个写入而不删除，由迁移线程把更新后的元素带到目标分片
+    template <typename Write>
+    void write(const Key& key, Write write) {
+        auto apply = [&write](Slice& s) -> bool {
+            if constexpr (std::is_same_v<decltype(write(s)), bool>) {
+                return write(s);
+            } else {
+                write(s);
+                return true;
+            }
+        };
+        Route r = route();
+        Slice* written = nullptr;
+        bool wrote = false;
+        if (!r.migrating()) {
+            int index = sliceOf(key, r);
+            written = &slice(index);
+            wrote = apply(*written);
+            if (skewThreshold_.load(std::memory_order_acquire) > 0) countWrite(index);
+            if (!changedSince(r)) return;
+            r = route();  // 写入期间路由发生了变化：按新的路由重做，不在旧分片中留下迁移线程可能漏掉的值
+        }
+        Slice& target = slice(sliceOf(key, r));
+        if (&target != written) wrote = apply(target);
+        Slice& source = slice(sourceOf(key, r));
+        if (&source != &target) {
+            if (wrote) {
+                source.remove(key);
+            } else if (&source != written) {
+                apply(source);
+            }
+        }
+        if (written && written != &target && written != &source) written->remove(key);
+    }
+
+    // 条件写入（比较并写入）：update(slice, valid) 在 key 当前所在的分片上比较并写入，返回是否写入；
+    // valid(inserting) 需要在分片的锁内、写入之前调用，返回false时不写入。路由在此之前发生变化时 valid 返回false，
+    // 这里按新的路由重做：迁移线程快照分片的 key 也要加这把锁，写入要么被快照看到，要么发生在路由变化之前，
+    // 不需要像 write 那样写入之后再补写（条件写入不能重复执行）。
+    // 迁移中 key 不在目标分片而仍在源分片（present(slice) 查询是否存在）时在源分片上比较并更新，由迁移线程带到目标分片；
+    // 源分片中不会插入新元素，已被迁走时同样按新的位置重做
+    template <typename Present, typename Update>
+    bool writeIf(const Key& key, Present present, Update update) {
+        while (true) {
+            Route r = route();
+            uint64_t batch = movingBatch_.load(std::memory_order_seq_cst);
+            int index = sliceOf(key, r);
+            Slice* chosen = &slice(index);
+            if (r.migrating()) {
+                Slice& source = slice(sourceOf(key, r));
+                if (&source != chosen && !present(*chosen) && present(source)) chosen = &source;
+            }
+            bool inSource = chosen != &slice(index);
+            bool rerouted = false;
+            bool written = update(*chosen, [&](bool inserting) {
+                // 迁移中插入新元素前确认 key 不在在途的批次中，否则插入的值会使迁移来的值被丢弃
+                rerouted = (inserting && (inSource || (r.migrating() && movedSince(batch)))) || changedSince(r);
+                return !rerouted;
+            });
+            if (rerouted) {
+                waitForBatch(batch);
+                continue;
+            }
+            if (written && !r.migrating() && skewThreshold_.load(std::memory_order_acquire) > 0) countWrite(index);
+            return written;
+        }
+    }
+
+    // 删除：迁移中源分片与目标分片都删除
+    bool remove(const Key& key) {
+        return removeEverywhere([&](const Route& r) -> size_t {
+                   bool removed = r.migrating() && slice(sourceOf(key, r)).remove(key);
+                   return slice(sliceOf(key, r)).remove(key) || removed;
+               }) > 0;
+    }
+
+    // 执行一次删除 remove(route)，返回删除的个数。迁移线程取出一批元素之后、写入目标分片之前，
+    // 这批元素在两个分片中都找不到，删除会漏掉它们，随后又被写回。迁移中或期间路由发生变化时，
+    // 等在途的这一批写完，再按当前路由删除一次：之后开始的批次已经取不到被删除的元素
+    template <typename Remove>
+    size_t removeEverywhere(Remove remove) {
+        Route r = route();
+        size_t removed = remove(r);
+        if (!r.migrating() && !changedSince(r)) return removed;
+        waitForBatch(movingBatch_.load(std::memory_order_seq_cst));
+        return removed + remove(route());
+    }
+
+private:
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static constexpr uint64_t kSkewCheckInterval = 4096;  // 分片的写入次数每增加这么多，检查一次是否倾斜
+
+    static uint64_t pack(uint32_t version, int fromSeedSlot, int toSeedSlot, int from, int to) {
+        return (static_cast<uint64_t>(version & 0x3fffffff) << 34) | (static_cast<uint64_t>(fromSeedSlot) << 33) |
+               (static_cast<uint64_t>(toSeedSlot) << 32) | (static_cast<uint64_t>(from) << 16) |
+               static_cast<uint64_t>(to);
+    }
+
+    // 读取 batch 时有一批元素在途，或者之后开始了新的批次
+    bool movedSince(uint64_t batch) const { return (batch & 1) || movingBatch_.load(std::memory_order_seq_cst) != batch; }
+
+    // batch 为读取到的批次计数，为奇数时等这一批写完
+    void waitForBatch(uint64_t batch) const {
+        if (!(batch & 1)) return;
+        while (movingBatch_.load(std::memory_order_seq_cst) == batch) std::this_thread::yield();
+    }
+
+    uint64_t hashOf(const Key& key, int seedSlot) const {
+        return KSeededHash<Key>(seeds_[seedSlot].load(std::memory_order_relaxed))(key);
+    }
+
+    // 持有 mutex_ 时调用：准备目标分片，发布迁移中的路由并启动迁移线程。prepare 不为空时，
+    // 迁移线程开始迁移前先对所有已创建的分片执行 prepare
+    void startMigration(const Route& current, int sliceNum, int toSeedSlot,
+                        std::function<void(Slice&)> prepare = nullptr) {
+        if (migrator_.joinable()) migrator_.join();
+
+        int from = current.to();
+        size_t transitional = std::max(sliceCapacity(from), sliceCapacity(sliceNum));
+        for (int i = 0; i < sliceNum; ++i) {
+            if (i < allocated_) {
+                slices_[i]->setCapacity(transitional);  // 迁移期间按较大的容量，避免移入的元素挤出原有元素
+            } else {
+                slices_[i].reset(factory_(i, transitional));
+                for (auto& setting : settings_) setting.second(*slices_[i]);
+            }
+        }
+        allocated_ = std::max(allocated_, sliceNum);
+        Route target{pack(current.version() + 1, current.toSeedSlot(), toSeedSlot, from, sliceNum)};
+        route_.store(target.word, std::memory_order_release);
+        migrator_ = std::thread([this, target, prepare = std::move(prepare), allocated = allocated_] {
+            if (prepare) {
+                for (int i = 0; i < allocated && !stop_.load(std::memory_order_relaxed); ++i) prepare(*slices_[i]);
+            }
+            migrate(target);
+        });
+    }
+
+    bool reseedLocked(uint64_t seed) {
+        Route current = route();
+        if (current.migrating()) return false;
+        if (seed == seeds_[current.toSeedSlot()].load(std::memory_order_relaxed)) return true;
+        // 写入当前路由没有使用的槽位：稳定状态下源与目标使用同一个槽位
+        int slot = 1 - current.toSeedSlot();
+        seeds_[slot].store(seed, std::memory_order_relaxed);
+        std::function<void(Slice&)> reseedIndex;
+        if (indexSeeder_) {
+            uint64_t indexSeed = seed != 0 ? wyhash64(seed, 1) : 0;
+            reseedIndex = [seeder = indexSeeder_, indexSeed](Slice& slice) { seeder(slice, indexSeed); };
+            settings_["hashSeed"] = reseedIndex;  // 以后新建的分片同样使用
+        }
+        // 重建哈希表需要重新插入分片内的所有元素，放在迁移线程中进行，倾斜检测触发时不阻塞写入线程
+        startMigration(current, current.to(), slot, std::move(reseedIndex));
+        return true;
+    }
+
+    void countWrite(int index) {
+        uint64_t count = writeCounts_[index].value.fetch_add(1, std::memory_order_relaxed) + 1;
+        // 最热的分片最先达到检查间隔
+        if (count % kSkewCheckInterval == 0) checkSkew();
+    }
+
+    void checkSkew() {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        Route r = route();
+        if (r.migrating()) return;
+
+        uint64_t total = 0, hottest = 0;
+        for (int i = 0; i < r.to(); ++i) {
+            uint64_t count = writeCounts_[i].value.load(std::memory_order_relaxed);
+            total += count;
+            hottest = std::max(hottest, count);
+        }
+        if (total < skewWindow_) return;
+        for (int i = 0; i < kMaxSlices; ++i) writeCounts_[i].value.store(0, std::memory_order_relaxed);
+
+        double threshold = skewThreshold_.load(std::memory_order_relaxed);
+        bool skewed = r.to() > 1 && hottest * r.to() > threshold * total;
+        if (skewed && reseededLastWindow_) {
+            skewWindow_ *= 2;  // 换种子没有改善，倾斜来自少数热点 key
+            reseededLastWindow_ = false;
+            return;
+        }
+        reseededLastWindow_ = skewed && reseedLocked(randomSeed());
+        if (reseededLastWindow_) skewReseeds_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t sliceCapacity(int count) const { return std::ceil(capacity_.load() / static_cast<double>(count)); }
+
+    // 后台迁移：逐个分片快照 key，把不再属于该分片的 key 按批移到目标分片
+    void migrate(Route target) {
+        int to = target.to();
+        int scanned = std::max(target.from(), to);
+        std::vector<Key> keys, moving;
+        std::vector<std::pair<Key, Value>> batch;
+        for (int i = 0; i < scanned && !stop_.load(std::memory_order_relaxed); ++i) {
+            keys.clear();
+            moving.clear();
+            slices_[i]->collectKeys(keys);
+            for (const Key& key : keys) {
+                if (sliceOf(key, target) != i) moving.push_back(key);
+            }
+            for (size_t begin = 0; begin < moving.size() && !stop_.load(std::memory_order_relaxed);
+                 begin += kMigrationBatch) {
+                batch.clear();
+                movingBatch_.fetch_add(1, std::memory_order_seq_cst);  // 奇数：有一批元素在途
+                slices_[i]->extract(moving.data() + begin, std::min(kMigrationBatch, moving.size() - begin), batch);
+                for (auto& entry : batch) {
+                    slices_[sliceOf(entry.first, target)]->putIfAbsent(entry.first, std::move(entry.second));
+                }
+                movingBatch_.fetch_add(1, std::memory_order_seq_cst);
+                std::this_thread::yield();
+            }
+        }
+        if (stop_.load(std::memory_order_relaxed)) return;
+
+        for (int i = to; i < scanned; ++i) slices_[i]->purge();  // 缩容后不再使用的分片，保留对象以便再次扩容
+        route_.store(pack(target.version() + 1, target.toSeedSlot(), target.toSeedSlot(), to, to),
+                     std::memory_order_seq_cst);
+        // 在发布稳定路由之后读取总容量：迁移期间调用 setCapacity 时只更新总容量，由这里应用到各分片
+        for (int i = 0; i < to; ++i) slices_[i]->setCapacity(sliceCapacity(to));
+    }
+
+private:
+    std::atomic<size_t> capacity_;                                           // 总容量
+    std::function<Slice*(int, size_t)> factory_;                            // 创建分片
+    std::vector<std::unique_ptr<Slice>> slices_;                             // 固定 kMaxSlices 个位置，创建后不再移动
+    int allocated_ = 0;                                                      // 已创建的分片个数
+    std::atomic<uint64_t> route_{0};                                         // 路由状态，见 Route
+    std::atomic<uint64_t> seeds_[2] = {};                                    // 两个种子槽位，换种子时交替使用
+    std::map<std::string, std::function<void(Slice&)>> settings_;           // 新建分片时需要重放的设置
+    std::function<void(Slice&, uint64_t)> indexSeeder_;                      // 分片内部哈希表的换种子方式，可为空
+    std::mutex mutex_;                                                       // 串行化调整与设置
+    std::thread migrator_;                                                   // 后台迁移线程
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> movingBatch_{0};                                   // 迁移批次计数，为奇数时有一批元素在途
+    std::unique_ptr<Counter[]> writeCounts_;                                 // 各分片的写入次数，开启倾斜检测后分配
+    std::atomic<double> skewThreshold_{0};                                   // 倾斜阈值，为 0 表示不检测
+    size_t skewWindow_ = 0;                                                  // 评估窗口（写入次数），由 mutex_ 保护
+    bool reseededLastWindow_ = false;                                        // 上一个窗口是否换了种子
+    std::atomic<size_t> skewReseeds_{0};
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+namespace KamaCache {
+
+// 识别到扫描流量后的处理方式
+enum class KScanPolicy {
+    InsertCold,  // 新 key 插入到淘汰端，下一次淘汰时最先被淘汰
+    Bypass,      // 新 key 不进入缓存
+};
+
+// 客户端提示：作用域内当前线程的所有访问都视为扫描，例如批处理任务遍历数据时
+class KScanHint {
+public:
+    KScanHint() { ++depth(); }
+
+    ~KScanHint() { --depth(); }
+
+    KScanHint(const KScanHint&) = delete;
+    KScanHint& operator=(const KScanHint&) = delete;
+
+    static bool active() { return depth() > 0; }
+
+private:
+    static int& depth() {
+        static thread_local int depth = 0;
+        return depth;
+    }
+};
+
+// 扫描检测：除了 KScanHint 之外，对整数 key 还会识别连续递增/递减的访问序列。
+// 按线程把访问划分到若干个流中分别跟踪，流的状态是原子变量，不需要加锁
+template <typename Key>
+class KScanDetector {
+public:
+    explicit KScanDetector(uint32_t runThreshold = 16, KScanPolicy policy = KScanPolicy::InsertCold)
+        : runThreshold_(runThreshold), policy_(policy) {}
+
+    KScanPolicy policy() const { return policy_; }
+
+    // 记录一次访问 | 该访问属于扫描时返回true
+    bool observe(const Key& key) {
+        if (KScanHint::active()) return true;
+        if constexpr (std::is_integral<Key>::value) {
+            Stream& stream = streams_[std::hash<std::thread::id>{}(std::this_thread::get_id()) % kStreams];
+            int64_t current = static_cast<int64_t>(key);
+            int64_t last = stream.lastKey.exchange(current, std::memory_order_relaxed);
+            uint32_t run = stream.run.load(std::memory_order_relaxed);
+            if (current == last) return run >= runThreshold_;  // 同一个 key 的 get 紧接着 put（旁路缓存）不打断序列
+
+            int step = 0;  // 相邻两次访问的方向，在 INT64_MAX / INT64_MIN 处不溢出
+            if (last != INT64_MAX && current == last + 1) {
+                step = 1;
+            } else if (last != INT64_MIN && current == last - 1) {
+                step = -1;
+            }
+            if (step != 0 && step == stream.direction.load(std::memory_order_relaxed)) {
+                ++run;
+            } else {
+                // 方向改变（例如在两个相邻的热点 key 之间来回访问）或不相邻时重新计数
+                stream.direction.store(step, std::memory_order_relaxed);
+                run = step != 0 ? 1 : 0;
+            }
+            stream.run.store(run, std::memory_order_relaxed);
+            return run >= runThreshold_;
+        } else {
+            return false;
+        }
+    }
+
+private:
+    static constexpr size_t kStreams = 16;
+
+    struct alignas(64) Stream {
+        std::atomic<int64_t> lastKey{0};
+        std::atomic<uint32_t> run{0};      // 当前连续序列的长度
+        std::atomic<int> direction{0};     // 当前序列的方向：1 递增，-1 递减，0 没有序列
+    };
+
+    uint32_t runThreshold_;  // 连续序列达到该长度后视为扫描
+    KScanPolicy policy_;
+    Stream streams_[kStreams];
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace KamaCache {
+
+// 按实例取种子的哈希（wyhash final4）。std::hash 不带种子，整数 key 还是恒等映射，
+// 一组特意构造或恰好有规律的 key 会集中到同一个分片或同一个哈希桶；换用随机种子后，不知道种子就无法构造这样的 key 集合
+
+namespace detail {
+
+constexpr uint64_t kWySecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull,
+                                   0x589965cc75374cc3ull};
+
+inline void wyMum(uint64_t* a, uint64_t* b) {
+    __uint128_t r = *a;
+    r *= *b;
+    *a = static_cast<uint64_t>(r);
+    *b = static_cast<uint64_t>(r >> 64);
+}
+
+inline uint64_t wyMix(uint64_t a, uint64_t b) {
+    wyMum(&a, &b);
+    return a ^ b;
+}
+
+inline uint64_t wyRead8(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint64_t wyRead4(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t wyRead3(const uint8_t* p, size_t k) {
+    return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+template <typename T>
+struct IsStringLike : std::false_type {};
+template <typename C, typename T, typename A>
+struct IsStringLike<std::basic_string<C, T, A>> : std::true_type {};
+template <typename C, typename T>
+struct IsStringLike<std::basic_string_view<C, T>> : std::true_type {};
+
+}  // namespace detail
+
+// 对 len 字节的数据计算带种子的 64 位哈希
+inline uint64_t wyhash(const void* data, size_t len, uint64_t seed) {
+    using namespace detail;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint64_t* s = kWySecret;
+    seed ^= wyMix(seed ^ s[0], s[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyRead4(p) << 32) | wyRead4(p + ((len >> 3) << 2));
+            b = (wyRead4(p + len - 4) << 32) | wyRead4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyRead3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wyMix(wyRead8(p) ^ s[1], wyRead8(p + 8) ^ seed);
+                see1 = wyMix(wyRead8(p + 16) ^ s[2], wyRead8(p + 24) ^ see1);
+                see2 = wyMix(wyRead8(p + 32) ^ s[3], wyRead8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wyMix(wyRead8(p) ^ s[1], wyRead8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyRead8(p + i - 16);
+        b = wyRead8(p + i - 8);
+    }
+    a ^= s[1];
+    b ^= seed;
+    wyMum(&a, &b);
+    return wyMix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+// 对一个 64 位整数计算带种子的哈希（wyhash64）
+inline uint64_t wyhash64(uint64_t value, uint64_t seed) {
+    using namespace detail;
+    uint64_t a = value ^ kWySecret[0], b = seed ^ kWySecret[1];
+    wyMum(&a, &b);
+    return wyMix(a ^ kWySecret[0], b ^ kWySecret[1]);
+}
+
+// 生成一个非零的随机种子
+inline uint64_t randomSeed() {
+    std::random_device device;
+    uint64_t seed = (static_cast<uint64_t>(device()) << 32) ^ device() ^
+                    static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    seed = wyhash64(seed, reinterpret_cast<uintptr_t>(&device));
+    return seed != 0 ? seed : 1;
+}
+
+// 带种子的哈希函数对象，可作为 unordered_map 的 Hash。种子为 0（默认）时等同于 std::hash<Key>，
+// 非 0 时字符串按内容计算 wyhash，整数与枚举用 wyhash64，其余类型对 std::hash 的结果再做一次带种子的混合
+template <typename Key>
+class KSeededHash {
+public:
+    KSeededHash() = default;
+    explicit KSeededHash(uint64_t seed) : seed_(seed) {}
+
+    size_t operator()(const Key& key) const {
+        if (seed_ == 0) return std::hash<Key>{}(key);
+        if constexpr (detail::IsStringLike<Key>::value) {
+            return wyhash(key.data(), key.size() * sizeof(typename Key::value_type), seed_);
+        } else if constexpr (std::is_integral_v<Key> || std::is_enum_v<Key>) {
+            return wyhash64(static_cast<uint64_t>(key), seed_);
+        } else {
+            return wyhash64(std::hash<Key>{}(key), seed_);
+        }
+    }
+
+    uint64_t seed() const { return seed_; }
+
+private:
+    uint64_t seed_ = 0;
+};
+
+}  // namespace KamaCache
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "KICachePolicy.h"
+
+namespace KamaCache {
+
+// 组相联缓存：仿照 CPU 缓存，key 哈希到一个由 Ways 路组成的组，组内数据连续存放。
+// 每一路有一个 1 字节的标签，一条 SSE2 比较指令即可找出标签匹配的路，查找只访问一两条缓存行，没有指针跳转。
+// 组内 LRU 用打包在一个 64 位字中的 4 位排名实现（0 为最近使用），每个组一把 seqlock：
+// Key/Value 可平凡拷贝时读操作乐观地读取、校验版本号后重试，不写任何共享状态（排名更新除外）；
+// 否则读操作也需要获取组锁。相比全相联的 KLruCache，组内冲突会损失少量命中率，换取更高的吞吐
+template <typename Key, typename Value, int Ways = 16>
+class KSetAssocCache : public KICachePolicy<Key, Value> {
+    static_assert(Ways == 8 || Ways == 16, "Ways 只能是 8 或 16");
+
+public:
+    // 实际容量为 Ways 乘以 2 的幂个组，不小于 capacity
+    explicit KSetAssocCache(size_t capacity) {
+        size_t sets = static_cast<size_t>(std::ceil(capacity / static_cast<double>(Ways)));
+        setCount_ = 1;
+        while (setCount_ < sets) setCount_ <<= 1;
+        sets_.reset(new Set[setCount_]);
+    }
+
+    ~KSetAssocCache() override = default;
+
+    size_t capacity() const { return setCount_ * Ways; }
+
+    void put(Key key, Value value) override {
+        uint64_t h = hash(key);
+        Set& set = sets_[h & (setCount_ - 1)];
+        uint8_t tag = tagOf(h);
+
+        uint32_t seq = lockSet(set);
+        int way = findWay(set, tag, key);
+        if (way < 0) {
+            way = victimWay(set);
+            set.tags[way] = tag;
+            set.keys[way] = key;
+        }
+        set.values[way] = value;
+        touch(set, way);
+        unlockSet(set, seq);
+    }
+
+    bool get(Key key, Value& value) override {
+        uint64_t h = hash(key);
+        return lookup(sets_[h & (setCount_ - 1)], tagOf(h), key, value);
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 批量查询：每 kPrefetchGroup 个 key 一组，先算出所有组的位置并预取，再逐个查找，组内的缓存未命中互相重叠 |
+    // 返回命中数。withPrefetch 为 false 时不预取，用于对比
+    size_t getBatch(const Key* keys, size_t count, Value* values, bool* found, bool withPrefetch = true) {
+        size_t hits = 0;
+        uint64_t hashes[kPrefetchGroup];
+        for (size_t base = 0; base < count; base += kPrefetchGroup) {
+            size_t n = std::min(kPrefetchGroup, count - base);
+            for (size_t i = 0; i < n; ++i) {
+                hashes[i] = hash(keys[base + i]);
+                if (!withPrefetch) continue;
+                const char* set = reinterpret_cast<const char*>(&sets_[hashes[i] & (setCount_ - 1)]);
+                for (size_t offset = 0; offset < sizeof(Set) && offset < kPrefetchBytes; offset += 64) {
+                    prefetch(set + offset);
+                }
+            }
+            for (size_t i = 0; i < n; ++i) {
+                const Key& key = keys[base + i];
+                found[base + i] = lookup(sets_[hashes[i] & (setCount_ - 1)], tagOf(hashes[i]), key, values[base + i]);
+                hits += found[base + i];
+            }
+        }
+        return hits;
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        uint64_t h = hash(key);
+        Set& set = sets_[h & (setCount_ - 1)];
+        uint32_t seq = lockSet(set);
+        int way = findWay(set, tagOf(h), key);
+        if (way >= 0) set.tags[way] = 0;
+        unlockSet(set, seq);
+        return way >= 0;
+    }
+
+private:
+    static constexpr bool kOptimisticRead = std::is_trivially_copyable<Key>::value
+                                            && std::is_trivially_copyable<Value>::value;
+    static constexpr size_t kPrefetchGroup = 16;   // 批量查询中同时在途的 key 个数
+    static constexpr size_t kPrefetchBytes = 256;  // 每个组最多预取的字节数
+
+    static void prefetch(const void* address) {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // 初始排名：第 i 路排名为 i，排名始终是 0..Ways-1 的一个排列
+    static constexpr uint64_t kInitialRanks = Ways == 16 ? 0xFEDCBA9876543210ull : 0x76543210ull;
+
+    struct alignas(64) Set {
+        std::atomic<uint32_t> seq{0};               // seqlock 版本号，奇数表示正在写
+        std::atomic<uint64_t> ranks{kInitialRanks};  // 每路 4 位的 LRU 排名
+        alignas(16) uint8_t tags[Ways] = {};         // 0 表示空闲
+        Key keys[Ways];
+        Value values[Ways];
+    };
+
+    static void pause() {
+#if defined(__SSE2__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // 在指定的组中查找 key，命中时提升其排名
+    bool lookup(Set& set, uint8_t tag, const Key& key, Value& value) {
+        int way = -1;
+        if constexpr (kOptimisticRead) {
+            // seqlock 读：版本号为奇数表示有写者，读完后版本号不变才说明读到的是一致的快照
+            while (true) {
+                uint32_t before = set.seq.load(std::memory_order_acquire);
+                if (before & 1) {
+                    pause();
+                    continue;
+                }
+                way = findWay(set, tag, key);
+                if (way >= 0) value = set.values[way];
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (set.seq.load(std::memory_order_relaxed) == before) break;
+            }
+        } else {
+            uint32_t seq = lockSet(set);
+            way = findWay(set, tag, key);
+            if (way >= 0) value = set.values[way];
+            unlockSet(set, seq);
+        }
+
+        if (way < 0) return false;
+        touch(set, way);
+        return true;
+    }
+
+    // std::hash 对整数是恒等映射，再用 murmur3 的 finalizer 打散：低位选组，高位作标签
+    static uint64_t hash(const Key& key) {
+        uint64_t h = std::hash<Key>{}(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint8_t tagOf(uint64_t h) {
+        uint8_t tag = static_cast<uint8_t>(h >> 56);
+        return tag == 0 ? 1 : tag;
+    }
+
+    // 标签与 tag 相等的路组成的位掩码
+    static uint32_t matchTags(const Set& set, uint8_t tag) {
+#if defined(__SSE2__)
+        __m128i needle = _mm_set1_epi8(static_cast<char>(tag));
+        __m128i tags = Ways == 16 ? _mm_load_si128(reinterpret_cast<const __m128i*>(set.tags))
+                                  : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(set.tags));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(tags, needle))) & ((1u << Ways) - 1);
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < Ways; ++i) mask |= static_cast<uint32_t>(set.tags[i] == tag) << i;
+        return mask;
+#endif
+    }
+
+    // 标签匹配后再比较 key，返回所在的路，未找到返回-1
+    static int findWay(const Set& set, uint8_t tag, const Key& key) {
+        for (uint32_t mask = matchTags(set, tag); mask != 0; mask &= mask - 1) {
+            int way = __builtin_ctz(mask);
+            if (set.keys[way] == key) return way;
+        }
+        return -1;
+    }
+
+    // 优先使用空闲的路，否则淘汰排名最大（最久未使用）的路
+    static int victimWay(const Set& set) {
+        uint32_t empty = matchTags(set, 0);
+        if (empty != 0) return __builtin_ctz(empty);
+        uint64_t ranks = set.ranks.load(std::memory_order_relaxed);
+        for (int way = 0; way < Ways; ++way) {
+            if (((ranks >> (way * 4)) & 0xF) == Ways - 1) return way;
+        }
+        return 0;
+    }
+
+    // 把 way 的排名置 0，排名比它小的路各加 1。读操作也会调用，因此用 CAS 更新；排名已经是 0 时不写
+    static void touch(Set& set, int way) {
+        uint64_t ranks = set.ranks.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t rank = (ranks >> (way * 4)) & 0xF;
+            if (rank == 0) return;
+            uint64_t updated = ranks;
+            for (int i = 0; i < Ways; ++i) {
+                uint64_t r = (ranks >> (i * 4)) & 0xF;
+                if (r < rank) updated += 1ull << (i * 4);
+            }
+            updated &= ~(0xFull << (way * 4));
+            if (set.ranks.compare_exchange_weak(ranks, updated, std::memory_order_relaxed)) return;
+        }
+    }
+
+    // 获取组的写锁：把偶数版本号改为奇数 | 返回加锁前的版本号
+    static uint32_t lockSet(Set& set) {
+        while (true) {
+            uint32_t seq = set.seq.load(std::memory_order_relaxed);
+            if (!(seq & 1) && set.seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire)) {
+                std::atomic_thread_fence(std::memory_order_release);
+                return seq;
+            }
+            pause();
+        }
+    }
+
+    static void unlockSet(Set& set, uint32_t seq) { set.seq.store(seq + 2, std::memory_order_release); }
+
+private:
+    size_t setCount_;  // 组数，2 的幂
+    std::unique_ptr<Set[]> sets_;
+};
+
+}  // namespace KamaCache
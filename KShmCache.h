@@ -0,0 +1,397 @@
+#pragma once
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "KICachePolicy.h"
+
+namespace KamaCache {
+
+// KShmCache 的 key 哈希：不同进程中必须得到相同的结果，因此不能使用 std::hash。
+// 默认实现直接对 key 的字节做 FNV-1a，只适用于没有填充字节、且值相等等价于字节相等的类型；
+// 含填充字节的结构体请为其特化 KShmKeyHash，只对有效字段求哈希
+template <typename Key>
+struct KShmKeyHash {
+    static_assert(std::has_unique_object_representations<Key>::value,
+                  "Key 含填充字节或多种等值表示，请为其特化 KamaCache::KShmKeyHash");
+
+    uint64_t operator()(const Key& key) const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(&key);
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(Key); ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+// 进程间共享的缓存：槽位、哈希索引和 CLOCK 淘汰信息全部位于一块 POSIX 共享内存中，
+// 同一台机器上的多个进程（例如 pre-fork 的 worker）打开同名缓存即可共享同一份数据，不需要经过 socket。
+// 共享内存在各进程中的映射地址不同，因此内部只使用下标（相对偏移）而不使用指针；
+// Key 和 Value 必须是可平凡拷贝的定长类型（字符串可以用定长的 char 数组），key 用 operator== 比较、用 KShmKeyHash 求哈希。
+// 共享内存按分片划分，每个分片一把进程间共享的 robust 互斥锁：持锁进程崩溃后，下一个加锁的进程会重置该分片。
+// 命中时只设置槽位的 CLOCK 访问位，不移动任何链表
+template <typename Key, typename Value>
+class KShmCache : public KICachePolicy<Key, Value> {
+    static_assert(std::is_trivially_copyable<Key>::value, "KShmCache 的 Key 必须可平凡拷贝");
+    static_assert(std::is_trivially_copyable<Value>::value, "KShmCache 的 Value 必须可平凡拷贝");
+    static_assert(std::atomic<uint8_t>::is_always_lock_free, "共享内存中的原子变量必须是无锁的");
+
+public:
+    // 打开名为 name 的共享内存缓存，不存在时按 capacity/sliceNum 创建。
+    // 已存在的缓存必须以相同的参数打开，否则抛出 std::runtime_error
+    KShmCache(const std::string& name, size_t capacity, int sliceNum = 0) : name_(name) {
+        if (capacity == 0) throw std::invalid_argument("KShmCache capacity must be positive");
+        size_t slices = sliceNum > 0 ? sliceNum : std::max(1u, std::thread::hardware_concurrency());
+        size_t slotsPerSlice = static_cast<size_t>(std::ceil(capacity / static_cast<double>(slices)));
+        if (slotsPerSlice > INT32_MAX / 2) throw std::invalid_argument("KShmCache capacity too large");
+
+        Geometry geometry;
+        geometry.sliceNum = slices;
+        geometry.slotsPerSlice = slotsPerSlice;
+        geometry.bucketsPerSlice = slotsPerSlice * 2;  // 负载因子 0.5，冲突链很短
+        geometry.keySize = sizeof(Key);
+        geometry.valueSize = sizeof(Value);
+        geometry.sliceBytes = alignUp(sizeof(SliceHeader) + geometry.bucketsPerSlice * sizeof(int32_t), alignof(Slot))
+                              + geometry.slotsPerSlice * sizeof(Slot);
+        geometry.sliceBytes = alignUp(geometry.sliceBytes, 64);
+        size_t totalBytes = alignUp(sizeof(SegmentHeader), 64) + geometry.sliceNum * geometry.sliceBytes;
+
+        attach(geometry, totalBytes);
+    }
+
+    ~KShmCache() override {
+        if (base_ != nullptr) ::munmap(base_, mappedBytes_);
+    }
+
+    KShmCache(const KShmCache&) = delete;
+    KShmCache& operator=(const KShmCache&) = delete;
+
+    // 删除共享内存对象。已经打开的进程不受影响，最后一个进程解除映射后内存被回收
+    static void unlink(const std::string& name) { ::shm_unlink(name.c_str()); }
+
+    void put(Key key, Value value) override {
+        size_t h = hash(key);
+        SliceLock slice(this, h);
+        int32_t* bucket = slice.bucket(h);
+        for (int32_t i = *bucket; i >= 0; i = slice.slot(i).next) {
+            Slot& s = slice.slot(i);
+            if (keyEquals(s.key, key)) {
+                s.value = value;
+                s.referenced.store(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        int32_t index = slice.allocateSlot();
+        Slot& s = slice.slot(index);
+        s.key = key;
+        s.value = value;
+        s.referenced.store(0, std::memory_order_relaxed);
+        s.next = *bucket;
+        *bucket = index;
+        ++slice.header().size;
+    }
+
+    bool get(Key key, Value& value) override {
+        size_t h = hash(key);
+        SliceLock slice(this, h);
+        for (int32_t i = *slice.bucket(h); i >= 0; i = slice.slot(i).next) {
+            Slot& s = slice.slot(i);
+            if (keyEquals(s.key, key)) {
+                value = s.value;
+                s.referenced.store(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        size_t h = hash(key);
+        SliceLock slice(this, h);
+        int32_t* link = slice.bucket(h);
+        while (*link >= 0) {
+            Slot& s = slice.slot(*link);
+            if (keyEquals(s.key, key)) {
+                int32_t index = *link;
+                *link = s.next;
+                slice.freeSlot(index);
+                return true;
+            }
+            link = &s.next;
+        }
+        return false;
+    }
+
+    // 因持锁进程崩溃而被重置的分片次数（所有打开该缓存的进程累计）
+    uint32_t recoveredSlices() const { return header()->recovered.load(std::memory_order_relaxed); }
+
+    // 所有分片中的元素总数（各分片依次加锁统计，并发修改时只是近似值）
+    size_t size() {
+        size_t total = 0;
+        for (size_t i = 0; i < header()->geometry.sliceNum; ++i) {
+            SliceLock slice(this, i, true);
+            total += slice.header().size;
+        }
+        return total;
+    }
+
+private:
+    static constexpr uint64_t kMagic = 0x4b53484d43414348ull;  // "KSHMCACH"
+
+    // 共享内存的布局参数，打开已有的缓存时用于校验
+    struct Geometry {
+        uint64_t sliceNum;
+        uint64_t slotsPerSlice;
+        uint64_t bucketsPerSlice;
+        uint64_t keySize;
+        uint64_t valueSize;
+        uint64_t sliceBytes;
+
+        bool operator==(const Geometry& other) const { return std::memcmp(this, &other, sizeof(Geometry)) == 0; }
+    };
+
+    struct SegmentHeader {
+        uint64_t magic = 0;
+        std::atomic<uint32_t> ready{0};      // 创建者初始化完成后置1
+        std::atomic<uint32_t> recovered{0};  // 被重置的分片次数
+        Geometry geometry{};
+    };
+
+    struct SliceHeader {
+        pthread_mutex_t mutex;  // 进程间共享的 robust 锁
+        uint32_t clockHand = 0; // CLOCK 指针
+        uint32_t size = 0;
+        int32_t freeHead = -1;  // 空闲槽位链表
+    };
+
+    struct Slot {
+        Key key{};
+        Value value{};
+        int32_t next = -1;                   // 同一个哈希桶中的下一个槽位（或空闲链表中的下一个），-1 表示结尾
+        std::atomic<uint8_t> referenced{0};  // CLOCK 访问位
+    };
+
+    // 按分片加锁，并提供基于下标的访问
+    class SliceLock {
+    public:
+        SliceLock(KShmCache* cache, size_t hashOrIndex, bool isIndex = false) : cache_(cache) {
+            const Geometry& g = cache->header()->geometry;
+            size_t index = isIndex ? hashOrIndex : hashOrIndex % g.sliceNum;
+            base_ = reinterpret_cast<char*>(cache->base_) + alignUp(sizeof(SegmentHeader), 64) + index * g.sliceBytes;
+            cache->lockSlice(*this);
+        }
+
+        ~SliceLock() { pthread_mutex_unlock(&header().mutex); }
+
+        SliceHeader& header() { return *reinterpret_cast<SliceHeader*>(base_); }
+
+        int32_t* bucket(size_t h) {
+            const Geometry& g = cache_->header()->geometry;
+            // 分片选择用了 h 的低位，桶选择用高位，避免两者相关
+            return buckets() + (h >> 16) % g.bucketsPerSlice;
+        }
+
+        int32_t* buckets() { return reinterpret_cast<int32_t*>(base_ + sizeof(SliceHeader)); }
+
+        Slot& slot(int32_t index) {
+            const Geometry& g = cache_->header()->geometry;
+            char* slots = base_ + alignUp(sizeof(SliceHeader) + g.bucketsPerSlice * sizeof(int32_t), alignof(Slot));
+            return reinterpret_cast<Slot*>(slots)[index];
+        }
+
+        // 清空分片：所有桶置空，在每个槽位上重新构造 Slot 并放入空闲链表
+        void reset() {
+            const Geometry& g = cache_->header()->geometry;
+            for (size_t i = 0; i < g.bucketsPerSlice; ++i) buckets()[i] = -1;
+            for (size_t i = 0; i < g.slotsPerSlice; ++i) {
+                Slot* s = ::new (static_cast<void*>(&slot(static_cast<int32_t>(i)))) Slot;
+                s->next = (i + 1 < g.slotsPerSlice) ? static_cast<int32_t>(i + 1) : -1;
+            }
+            header().freeHead = 0;
+            header().clockHand = 0;
+            header().size = 0;
+        }
+
+        // 取一个空闲槽位，没有空闲槽位时按 CLOCK 淘汰一个
+        int32_t allocateSlot() {
+            SliceHeader& h = header();
+            if (h.freeHead >= 0) {
+                int32_t index = h.freeHead;
+                h.freeHead = slot(index).next;
+                return index;
+            }
+
+            const Geometry& g = cache_->header()->geometry;
+            while (true) {
+                int32_t index = static_cast<int32_t>(h.clockHand);
+                h.clockHand = static_cast<uint32_t>((h.clockHand + 1) % g.slotsPerSlice);
+                Slot& s = slot(index);
+                if (s.referenced.exchange(0, std::memory_order_relaxed) != 0) continue;  // 给第二次机会
+                unlink(index);
+                --h.size;
+                return index;
+            }
+        }
+
+        // 把已从哈希链中摘下的槽位放回空闲链表
+        void freeSlot(int32_t index) {
+            Slot& s = slot(index);
+            s.next = header().freeHead;
+            header().freeHead = index;
+            --header().size;
+        }
+
+    private:
+        // 把槽位从其所在的哈希链中摘下
+        void unlink(int32_t index) {
+            int32_t* link = bucket(cache_->hash(slot(index).key));
+            while (*link != index) link = &slot(*link).next;
+            *link = slot(index).next;
+        }
+
+    private:
+        KShmCache* cache_;
+        char* base_;
+    };
+
+    static size_t alignUp(size_t n, size_t align) { return (n + align - 1) / align * align; }
+
+    static bool keyEquals(const Key& a, const Key& b) { return a == b; }
+
+    // 不同进程中必须得到相同的哈希值：KShmKeyHash 的结果再用 murmur3 的 finalizer 打散
+    size_t hash(const Key& key) const {
+        uint64_t h = KShmKeyHash<Key>{}(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    SegmentHeader* header() const { return reinterpret_cast<SegmentHeader*>(base_); }
+
+    void lockSlice(SliceLock& slice) {
+        int rc = pthread_mutex_lock(&slice.header().mutex);
+#ifdef __linux__
+        if (rc == EOWNERDEAD) {
+            // 上一个持锁的进程在修改途中退出，分片状态可能不一致。缓存数据可以丢弃，直接重置该分片
+            slice.reset();
+            header()->recovered.fetch_add(1, std::memory_order_relaxed);
+            pthread_mutex_consistent(&slice.header().mutex);
+            rc = 0;
+        }
+#endif
+        if (rc != 0) throw std::runtime_error("KShmCache lock failed: " + std::string(std::strerror(rc)));
+    }
+
+    // 创建或打开共享内存并完成映射
+    void attach(const Geometry& geometry, size_t totalBytes) {
+        bool creator = true;
+        int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            creator = false;
+            fd = ::shm_open(name_.c_str(), O_RDWR, 0600);
+        }
+        if (fd < 0) throw std::runtime_error("shm_open " + name_ + ": " + std::strerror(errno));
+
+        if (creator) {
+            if (::ftruncate(fd, static_cast<off_t>(totalBytes)) < 0) {
+                int err = errno;
+                ::close(fd);
+                ::shm_unlink(name_.c_str());
+                throw std::runtime_error("ftruncate " + name_ + ": " + std::strerror(err));
+            }
+        } else if (!waitForSize(fd, totalBytes)) {
+            ::close(fd);
+            throw std::runtime_error("KShmCache " + name_ + " exists with a different size");
+        }
+
+        void* addr = ::mmap(nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) throw std::runtime_error("mmap " + name_ + ": " + std::strerror(errno));
+        base_ = addr;
+        mappedBytes_ = totalBytes;
+
+        if (creator) {
+            initialize(geometry);
+            return;
+        }
+
+        // 等待创建者完成初始化
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (header()->ready.load(std::memory_order_acquire) == 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("KShmCache " + name_ + " was never initialized");
+            }
+            std::this_thread::yield();
+        }
+        if (header()->magic != kMagic || !(header()->geometry == geometry)) {
+            throw std::runtime_error("KShmCache " + name_ + " exists with different parameters");
+        }
+    }
+
+    // 创建者 ftruncate 之前大小为0，稍作等待
+    static bool waitForSize(int fd, size_t expected) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        struct stat st {};
+        while (::fstat(fd, &st) == 0 && st.st_size == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        return static_cast<size_t>(st.st_size) == expected;
+    }
+
+    void initialize(const Geometry& geometry) {
+        SegmentHeader* h = ::new (base_) SegmentHeader;
+        h->magic = kMagic;
+        h->geometry = geometry;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+        for (size_t i = 0; i < geometry.sliceNum; ++i) {
+            char* sliceBase = reinterpret_cast<char*>(base_) + alignUp(sizeof(SegmentHeader), 64) + i * geometry.sliceBytes;
+            SliceHeader* sliceHeader = ::new (static_cast<void*>(sliceBase)) SliceHeader;
+            pthread_mutex_init(&sliceHeader->mutex, &attr);
+            SliceLock slice(this, i, true);
+            slice.reset();
+        }
+        pthread_mutexattr_destroy(&attr);
+        h->ready.store(1, std::memory_order_release);
+    }
+
+private:
+    std::string name_;
+    void* base_ = nullptr;
+    size_t mappedBytes_ = 0;
+};
+
+}  // namespace KamaCache
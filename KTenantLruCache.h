@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "KICachePolicy.h"
+#include "KLock.h"
+#include "KReshard.h"
+#include "KSeededHash.h"
+
+namespace KamaCache {
+
+// 单个租户的统计信息
+struct KTenantStats {
+    size_t quota = 0;      // 配额（元素个数）
+    size_t size = 0;       // 当前占用的元素个数，超过 quota 的部分是借用的空闲配额
+    size_t hits = 0;       // 命中次数
+    size_t misses = 0;     // 未命中次数
+    size_t evictions = 0;  // 被淘汰的元素个数
+
+    size_t borrowed() const { return size > quota ? size - quota : 0; }
+
+    KTenantStats& operator+=(const KTenantStats& other) {
+        quota += other.quota;
+        size += other.size;
+        hits += other.hits;
+        misses += other.misses;
+        evictions += other.evictions;
+        return *this;
+    }
+};
+
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KTenantLruCache;
+
+template <typename Key, typename Value>
+class TenantLruNode {
+private:
+    Key key_;
+    Value value_;
+    uint32_t tenant_;
+    TenantLruNode* prev_ = nullptr;
+    TenantLruNode* next_ = nullptr;
+
+public:
+    TenantLruNode(Key key, Value value, uint32_t tenant) : key_(key), value_(value), tenant_(tenant) {}
+
+    template <typename K, typename V, typename M>
+    friend class KTenantLruCache;
+};
+
+// 多租户 LRU：每个元素带租户标签，每个租户一条 LRU 链表和一个容量配额。
+// 缓存未满时任何租户都可以超出配额，借用其他租户空闲的配额；缓存已满时：
+//   1. 写入的租户已达到配额，淘汰它自己最旧的元素
+//   2. 否则从超出配额最多的租户中淘汰，收回被借走的配额。超配额租户按超出量挂在以超出量为下标的侵入式链表上，
+//      每次写入或淘汰超出量只变化 1，更新与找到受害者都是 O(1)，不分配内存
+//   3. 没有租户超出配额（配额总和大于容量）时淘汰写入租户自己的元素，它没有元素时淘汰占用比例最高的租户
+// 未设置配额的租户配额为 0，只能使用空闲容量，并且最先被淘汰。Mutex 为锁的类型，见 KLock.h
+template <typename Key, typename Value, typename Mutex>
+class KTenantLruCache : public KICachePolicy<Key, Value> {
+public:
+    using NodeType = TenantLruNode<Key, Value>;
+
+    static constexpr uint32_t kDefaultTenant = 0;
+
+    KTenantLruCache(int capacity) : capacity_(capacity) {}
+
+    ~KTenantLruCache() override = default;
+
+    // 设置租户的配额（元素个数），配额变小时超出的部分在缓存满后优先被收回
+    void setQuota(uint32_t tenant, size_t quota) {
+        std::lock_guard<Mutex> lock(mutex_);
+        Tenant& t = tenantOf(tenant);
+        t.stats.quota = quota;
+        updateOverQuota(t);
+    }
+
+    // 不带租户的接口归属默认租户
+    void put(Key key, Value value) override { put(kDefaultTenant, key, value); }
+
+    bool get(Key key, Value& value) override { return get(kDefaultTenant, key, value); }
+
+    Value get(Key key) override {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 写入租户 tenant 的元素：key 已属于其他租户时改归 tenant
+    void put(uint32_t tenant, Key key, Value value) {
+        if (capacity_ <= 0) return;
+
+        std::lock_guard<Mutex> lock(mutex_);
+        Tenant& t = tenantOf(tenant);
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end()) {
+            NodeType* node = it->second.get();
+            node->value_ = value;
+            if (node->tenant_ != tenant) {
+                Tenant& owner = tenants_[node->tenant_];
+                unlink(owner, node);
+                node->tenant_ = tenant;
+                pushFront(t, node);
+            } else {
+                moveToFront(t, node);
+            }
+            return;
+        }
+
+        if (nodeMap_.size() >= static_cast<size_t>(capacity_)) evictFor(t);
+        auto node = std::make_unique<NodeType>(key, value, tenant);
+        pushFront(t, node.get());
+        nodeMap_[key] = std::move(node);
+    }
+
+    // 查询 key，命中与未命中计入租户 tenant 的统计。读取不创建租户：没有设置配额也没有写入过的租户不记录统计
+    bool get(uint32_t tenant, Key key, Value& value) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto reader = tenants_.find(tenant);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) {
+            if (reader != tenants_.end()) ++reader->second.stats.misses;
+            return false;
+        }
+        if (reader != tenants_.end()) ++reader->second.stats.hits;
+        NodeType* node = it->second.get();
+        moveToFront(tenants_[node->tenant_], node);
+        value = node->value_;
+        return true;
+    }
+
+    // 删除指定元素 | 元素存在并被删除返回true
+    bool remove(Key key) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end()) return false;
+        unlink(tenants_[it->second->tenant_], it->second.get());
+        nodeMap_.erase(it);
+        return true;
+    }
+
+    // 租户的统计信息，未出现过的租户返回全 0
+    KTenantStats stats(uint32_t tenant) {
+        std::lock_guard<Mutex> lock(mutex_);
+        auto it = tenants_.find(tenant);
+        return it == tenants_.end() ? KTenantStats() : it->second.stats;
+    }
+
+private:
+    struct Tenant {
+        KTenantStats stats;
+        NodeType* head = nullptr;  // 最新
+        NodeType* tail = nullptr;  // 最旧
+        size_t excess = 0;         // 所在的 overQuota_ 链表下标，0 表示不在其中
+        Tenant* overPrev = nullptr;  // overQuota_[excess] 链表中的前后租户
+        Tenant* overNext = nullptr;
+    };
+
+    Tenant& tenantOf(uint32_t tenant) { return tenants_[tenant]; }
+
+    void evictFor(Tenant& writer) {
+        Tenant* victim = nullptr;
+        if (writer.stats.size >= writer.stats.quota && writer.tail) {
+            victim = &writer;
+        } else if (maxExcess_ > 0) {
+            victim = overQuota_[maxExcess_];
+        } else if (writer.tail) {
+            victim = &writer;
+        } else {
+            // 配额超额分配且写入的租户没有元素：淘汰占用比例最高的租户，只在配置不合理时发生
+            double worst = -1;
+            for (auto& entry : tenants_) {
+                Tenant& t = entry.second;
+                if (!t.tail) continue;
+                double ratio = t.stats.size / static_cast<double>(t.stats.quota + 1);
+                if (ratio > worst) {
+                    worst = ratio;
+                    victim = &t;
+                }
+            }
+        }
+        if (!victim) return;
+
+        NodeType* node = victim->tail;
+        unlink(*victim, node);
+        ++victim->stats.evictions;
+        nodeMap_.erase(nodeMap_.find(node->key_));  // 按迭代器删除：node->key_ 随结点一起析构
+    }
+
+    void pushFront(Tenant& t, NodeType* node) {
+        node->prev_ = nullptr;
+        node->next_ = t.head;
+        if (t.head) t.head->prev_ = node;
+        t.head = node;
+        if (!t.tail) t.tail = node;
+        ++t.stats.size;
+        updateOverQuota(t);
+    }
+
+    void unlink(Tenant& t, NodeType* node) {
+        if (node->prev_) {
+            node->prev_->next_ = node->next_;
+        } else {
+            t.head = node->next_;
+        }
+        if (node->next_) {
+            node->next_->prev_ = node->prev_;
+        } else {
+            t.tail = node->prev_;
+        }
+        node->prev_ = node->next_ = nullptr;
+        --t.stats.size;
+        updateOverQuota(t);
+    }
+
+    // 只调整链表，占用不变，不需要更新 overQuota_
+    void moveToFront(Tenant& t, NodeType* node) {
+        if (t.head == node) return;
+        node->prev_->next_ = node->next_;
+        if (node->next_) {
+            node->next_->prev_ = node->prev_;
+        } else {
+            t.tail = node->prev_;
+        }
+        node->prev_ = nullptr;
+        node->next_ = t.head;
+        t.head->prev_ = node;
+        t.head = node;
+    }
+
+    // 占用超过配额的租户挂在 overQuota_[超出量] 链表的头部，回到配额以内时移出。
+    // 超出量每次变化 1 时，最大超出量要么增加到 t 的新值，要么减 1 后 t 正好在那条链表上，下面的循环至多执行一次；
+    // 只有 setQuota 一次改变较多时才向下扫描
+    void updateOverQuota(Tenant& t) {
+        size_t excess = t.stats.borrowed();
+        if (excess == t.excess) return;
+        if (t.excess > 0) {
+            if (t.overPrev) {
+                t.overPrev->overNext = t.overNext;
+            } else {
+                overQuota_[t.excess] = t.overNext;
+            }
+            if (t.overNext) t.overNext->overPrev = t.overPrev;
+            t.overPrev = t.overNext = nullptr;
+        }
+        t.excess = excess;
+        if (excess > 0) {
+            // 只在超出量第一次达到新的最大值时扩容，按倍数增长
+            if (excess >= overQuota_.size()) overQuota_.resize(std::max(excess + 1, overQuota_.size() * 2), nullptr);
+            t.overNext = overQuota_[excess];
+            if (t.overNext) t.overNext->overPrev = &t;
+            overQuota_[excess] = &t;
+            maxExcess_ = std::max(maxExcess_, excess);
+        }
+        while (maxExcess_ > 0 && !overQuota_[maxExcess_]) --maxExcess_;
+    }
+
+private:
+    int capacity_;                                                 // 缓存容量
+    std::unordered_map<Key, std::unique_ptr<NodeType>> nodeMap_;   // key 到结点的映射，结点由这里持有
+    std::unordered_map<uint32_t, Tenant> tenants_;                 // 租户，元素地址在 rehash 后保持不变
+    std::vector<Tenant*> overQuota_;                               // 下标为超出量，超出这么多的租户组成的链表
+    size_t maxExcess_ = 0;                                         // 最大的超出量，0 表示没有租户超出配额
+    Mutex mutex_;                                                  // 互斥锁
+};
+
+// 多租户 LRU 的分片版本：key 按带种子的哈希经 jumpConsistentHash 选择分片（种子为 0 时即 std::hash，与 KHashLruCaches 相同）。
+// 总容量与每个租户的配额都按分片精确拆分，各分片之和等于设置的值，因此分片数在构造时固定
+template <typename Key, typename Value, typename Mutex = std::mutex>
+class KHashTenantLruCaches {
+public:
+    using SliceType = KTenantLruCache<Key, Value, Mutex>;
+
+    KHashTenantLruCaches(size_t capacity, int sliceNum, uint64_t hashSeed = 0) : hash_(hashSeed) {
+        int count = std::clamp(sliceNum > 0 ? sliceNum : static_cast<int>(std::thread::hardware_concurrency()), 1,
+                               KReshardableSlices<Key, Value, SliceType>::kMaxSlices);
+        for (int i = 0; i < count; ++i) sliceCaches_.emplace_back(new SliceType(share(capacity, i, count)));
+    }
+
+    void setQuota(uint32_t tenant, size_t quota) {
+        for (size_t i = 0; i < sliceCaches_.size(); ++i) sliceCaches_[i]->setQuota(tenant, share(quota, i, sliceCaches_.size()));
+    }
+
+    void put(uint32_t tenant, Key key, Value value) { sliceOf(key).put(tenant, key, value); }
+
+    bool get(uint32_t tenant, Key key, Value& value) { return sliceOf(key).get(tenant, key, value); }
+
+    bool remove(Key key) { return sliceOf(key).remove(key); }
+
+    // 汇总所有分片中该租户的统计信息
+    KTenantStats stats(uint32_t tenant) {
+        KTenantStats total;
+        for (auto& sliceCache : sliceCaches_) {
+            total += sliceCache->stats(tenant);
+        }
+        return total;
+    }
+
+private:
+    SliceType& sliceOf(const Key& key) {
+        return *sliceCaches_[jumpConsistentHash(hash_(key), static_cast<int>(sliceCaches_.size()))];
+    }
+
+    // 把 total 平分给 count 个分片时第 index 个分片的份额，余数分给前面的分片
+    static size_t share(size_t total, size_t index, size_t count) {
+        return total / count + (index < total % count ? 1 : 0);
+    }
+
+private:
+    KSeededHash<Key> hash_;                              // 分片选择
+    std::vector<std::unique_ptr<SliceType>> sliceCaches_;  // 切片缓存
+};
+
+}  // namespace KamaCache
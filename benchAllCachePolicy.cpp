@@ -0,0 +1,726 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KAllocator.h"
+#include "KFlatCombiningCache.h"
+#include "KFrequencySketch.h"
+#include "KFrozenHotSet.h"
+#include "KHugePageResource.h"
+#include "KLfuCache.h"
+#include "KLock.h"
+#include "KLruCache.h"
+#include "KRefreshingCache.h"
+#include "KSeededHash.h"
+#include "KSetAssocCache.h"
+
+// 各缓存引擎的吞吐量基准测试。不带参数运行全部场景，或指定场景名只运行其中一部分：./kcache_bench setassoc
+
+// 预先生成的 Zipf 分布访问序列，避免在计时区间内生成随机数
+std::vector<int> makeZipfTrace(int keySpace, size_t length, double skew, unsigned seed) {
+    std::vector<double> cdf(keySpace);
+    double sum = 0;
+    for (int i = 0; i < keySpace; ++i) {
+        sum += 1.0 / std::pow(i + 1, skew);
+        cdf[i] = sum;
+    }
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(0, sum);
+    // 打乱 key 的排名，热点 key 不集中在相邻的哈希位置
+    std::vector<int> permutation(keySpace);
+    for (int i = 0; i < keySpace; ++i) permutation[i] = i;
+    std::shuffle(permutation.begin(), permutation.end(), std::mt19937(7));
+
+    std::vector<int> trace(length);
+    for (auto& key : trace) {
+        key = permutation[std::lower_bound(cdf.begin(), cdf.end(), dist(gen)) - cdf.begin()];
+    }
+    return trace;
+}
+
+struct BenchResult {
+    double mops;      // 每秒百万次操作
+    double hitRatio;  // get 命中率
+};
+
+// threads 个线程按旁路缓存模式访问：get 未命中时 put。每个线程使用自己的访问序列
+template <typename Cache>
+BenchResult runThroughput(Cache& cache, int threads, size_t opsPerThread, int keySpace, double skew = 0.99) {
+    std::vector<std::vector<int>> traces;
+    for (int t = 0; t < threads; ++t) traces.push_back(makeZipfTrace(keySpace, 1 << 20, skew, 100 + t));
+
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<size_t> hits(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            const std::vector<int>& trace = traces[t];
+            ++ready;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            size_t localHits = 0;
+            int value = 0;
+            for (size_t i = 0; i < opsPerThread; ++i) {
+                int key = trace[i & (trace.size() - 1)];
+                if (cache.get(key, value)) {
+                    ++localHits;
+                } else {
+                    cache.put(key, key);
+                }
+            }
+            hits[t] = localHits;
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t totalHits = 0;
+    for (size_t h : hits) totalHits += h;
+    double totalOps = static_cast<double>(opsPerThread) * threads;
+    return {totalOps / seconds / 1e6, totalHits / totalOps};
+}
+
+void printRow(const std::string& name, int threads, const BenchResult& result) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(4) << threads << std::fixed
+              << std::setprecision(2) << std::setw(12) << result.mops << " Mops/s" << std::setw(10)
+              << 100 * result.hitRatio << "%" << std::endl;
+}
+
+std::vector<int> threadCounts() {
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+void benchSetAssociative() {
+    std::cout << "\n=== 组相联缓存与现有引擎的吞吐对比（Zipf 0.99，旁路缓存） ===" << std::endl;
+    const int CAPACITY = 1 << 16;
+    const int KEY_SPACE = CAPACITY * 4;
+    const size_t OPS = 2000000;
+    int slices = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int threads : threadCounts()) {
+        {
+            KamaCache::KLruCache<int, int> cache(CAPACITY);
+            printRow("KLruCache", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, slices);
+            printRow("KHashLruCaches", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            // 默认的 maxAverageNum 在热点负载下会频繁触发全表降频，这里放宽以测量查找本身的开销
+            KamaCache::KHashLfuCache<int, int> cache(CAPACITY, slices, 1 << 20);
+            printRow("KHashLfuCache", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            KamaCache::KSetAssocCache<int, int, 8> cache(CAPACITY);
+            printRow("KSetAssocCache<8 ways>", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            KamaCache::KSetAssocCache<int, int, 16> cache(CAPACITY);
+            printRow("KSetAssocCache<16 ways>", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+    }
+}
+
+void benchFrozenHotSet() {
+    std::cout << "\n=== 冻结热点集：无锁读冻结表，未命中回落到分片 LRU（Zipf 0.99，旁路缓存） ===" << std::endl;
+    const int CAPACITY = 1 << 16;
+    const int KEY_SPACE = CAPACITY * 4;
+    const size_t OPS = 2000000;
+    int slices = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int threads : threadCounts()) {
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, slices);
+            printRow("KHashLruCaches", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        for (size_t hotSetSize : {1024, 8192}) {
+            KamaCache::KFrozenHotSetCache<int, int> cache(CAPACITY, slices, hotSetSize);
+            printRow("KFrozenHotSetCache<" + std::to_string(hotSetSize) + ">", threads,
+                     runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+    }
+}
+
+// 单线程查询：逐个 get、按 BATCH 个一组 getBatch 但不预取、getBatch（分组预取）三者对比，一半的 key 不在缓存中。
+// 前两者之差是一次加锁（及批量接口本身）的收益，后两者之差才是预取的收益
+template <typename Cache, typename BatchGet>
+void runLookupPair(const std::string& name, Cache& cache, int capacity, BatchGet getBatch) {
+    const size_t LOOKUPS = 1 << 22;
+    const size_t BATCH = 64;
+    std::mt19937 gen(capacity);
+    std::uniform_int_distribution<int> dist(0, capacity * 2 - 1);
+    std::vector<int> keys(LOOKUPS);
+    for (auto& key : keys) key = dist(gen);
+
+    int value = 0;
+    size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int key : keys) hits += cache.get(key, value);
+    double single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int> values(BATCH);
+    std::unique_ptr<bool[]> found(new bool[BATCH]);
+    double batched[2];
+    size_t batchHits[2] = {0, 0};
+    for (int withPrefetch = 0; withPrefetch < 2; ++withPrefetch) {
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < LOOKUPS; i += BATCH) {
+            batchHits[withPrefetch] += getBatch(cache, &keys[i], BATCH, values.data(), found.get(), withPrefetch != 0);
+        }
+        batched[withPrefetch] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool consistent = hits == batchHits[0] && hits == batchHits[1];
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << capacity << std::fixed
+              << std::setprecision(2) << std::setw(10) << LOOKUPS / single / 1e6 << std::setw(12)
+              << LOOKUPS / batched[0] / 1e6 << std::setw(10) << LOOKUPS / batched[1] / 1e6 << " Mops/s" << std::setw(8)
+              << 100.0 * hits / LOOKUPS << "%" << (consistent ? "" : "  (命中数不一致)") << std::endl;
+}
+
+void benchPrefetchedLookup() {
+    std::cout << "\n=== 批量查询预取：单线程 get 与 getBatch 吞吐（Mops/s），缓存大小跨越 LLC；batch-nopf 为同样分组但不预取 ==="
+              << std::endl;
+    std::cout << std::left << std::setw(28) << "engine" << std::right << std::setw(10) << "entries" << std::setw(10)
+              << "get" << std::setw(12) << "batch-nopf" << std::setw(10) << "batch" << std::endl;
+    for (int capacity : {1 << 16, 1 << 20, 1 << 22}) {
+        {
+            KamaCache::KLruCache<int, int> cache(capacity);
+            for (int i = 0; i < capacity; ++i) cache.put(i * 2, i);
+            runLookupPair("KLruCache", cache, capacity,
+                          [](auto& c, const int* k, size_t n, int* v, bool* f, bool withPrefetch) {
+                              return c.getBatch(k, nullptr, n, v, f, withPrefetch);
+                          });
+        }
+        {
+            KamaCache::KSetAssocCache<int, int, 16> cache(capacity);
+            for (int i = 0; i < capacity; ++i) cache.put(i * 2, i);
+            runLookupPair("KSetAssocCache<16 ways>", cache, capacity,
+                          [](auto& c, const int* k, size_t n, int* v, bool* f, bool withPrefetch) {
+                              return c.getBatch(k, n, v, f, withPrefetch);
+                          });
+        }
+    }
+}
+
+// 少量热点 key 同时过期：统计 get 的延迟分布与回源次数
+void runRefreshScenario(const std::string& name, double beta, std::chrono::milliseconds staleWindow,
+                        bool refreshAhead = false) {
+    const int THREADS = 8;
+    const int HOT_KEYS = 16;
+    const auto TTL = std::chrono::milliseconds(100);
+    const auto LOAD_TIME = std::chrono::milliseconds(20);
+    const auto DURATION = std::chrono::seconds(2);
+
+    std::atomic<int> concurrentLoads{0}, maxConcurrentLoads{0};
+    KamaCache::KRefreshingCache<int, int> cache(
+        1024, 4,
+        [&](const int& key) {
+            int now = ++concurrentLoads;
+            int seen = maxConcurrentLoads.load();
+            while (now > seen && !maxConcurrentLoads.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(LOAD_TIME);
+            --concurrentLoads;
+            return key;
+        },
+        TTL, beta, staleWindow, 4);
+    if (refreshAhead) cache.enableRefreshAhead(std::make_shared<KamaCache::KMaintenanceScheduler>(), 4, 0.5);
+    const auto WARMUP = std::chrono::milliseconds(500);
+
+    // 预热阶段的访问不计入统计：首次加载是串行的，结束时部分 key 已经过期
+    std::vector<std::vector<double>> latencies(THREADS);
+    std::vector<std::thread> workers;
+    auto measureFrom = std::chrono::steady_clock::now() + WARMUP;
+    auto deadline = measureFrom + DURATION;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 gen(t);
+            while (std::chrono::steady_clock::now() < deadline) {
+                auto start = std::chrono::steady_clock::now();
+                cache.get(gen() % HOT_KEYS);
+                if (start >= measureFrom) {
+                    latencies[t].push_back(
+                        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+    }
+    std::this_thread::sleep_until(measureFrom);
+    size_t loadsBefore = cache.loads(), syncLoadsBefore = cache.syncLoads();
+    for (auto& worker : workers) worker.join();
+
+    std::vector<double> all;
+    for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[static_cast<size_t>(p * (all.size() - 1))]; };
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.99) << std::setw(10)
+              << percentile(0.999) << std::setw(10) << all.back() << " us" << std::setw(8)
+              << cache.loads() - loadsBefore << std::setw(8) << cache.syncLoads() - syncLoadsBefore << std::setw(8)
+              << maxConcurrentLoads.load() << std::endl;
+}
+
+void benchRefresh() {
+    std::cout << "\n=== 热点 key 过期：提前刷新与 stale-while-revalidate（TTL 100ms，加载耗时 20ms） ===" << std::endl;
+    std::cout << std::left << std::setw(24) << "mode" << std::right << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "max" << "   " << std::setw(8) << "loads" << std::setw(8)
+              << "sync" << std::setw(8) << "peak" << std::endl;
+    runRefreshScenario("到期同步加载", 0, std::chrono::milliseconds(0));
+    runRefreshScenario("XFetch", 1.0, std::chrono::milliseconds(0));
+    runRefreshScenario("stale-while-revalidate", 0, std::chrono::milliseconds(50));
+    runRefreshScenario("XFetch + SWR", 1.0, std::chrono::milliseconds(50));
+    runRefreshScenario("热点提前加载", 0, std::chrono::milliseconds(0), true);
+
+    // 开启提前加载后每次 get 都要在频率草图上记录访问（KRefreshingCache::recordAccess）：
+    // 两次 estimate 与 increment 共 12 次原子读、最多 4 次 CAS，另有一次对共享计数器的 fetch_add
+    auto sketchCost = [](int threads) {
+        const int OPS = 1000000;
+        KamaCache::KFrequencySketch sketch(1024);
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&sketch, t] {
+                std::mt19937 gen(t);
+                int hot = 0;
+                for (int i = 0; i < OPS; ++i) {
+                    uint64_t hash = std::hash<int>{}(gen() % 16);
+                    int before = sketch.estimate(hash);
+                    sketch.increment(hash);
+                    hot += before < 4 && sketch.estimate(hash) >= 4;
+                }
+                volatile int sink = hot;
+                (void)sink;
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        return elapsed.count() / OPS / threads;
+    };
+    std::cout << "提前加载每次 get 的草图开销（总耗时 / 总次数）: 1 线程 " << std::setprecision(1) << sketchCost(1)
+              << " ns, 8 线程 " << sketchCost(8) << " ns（16 个热点 key，含 4 次 CAS 与 1 次共享 fetch_add）" << std::endl;
+}
+
+void benchAllocator() {
+    std::cout << "\n=== 分配器：全局 new 与每个分片独立的内存池（Zipf 0.99，key 空间为容量的 8 倍，频繁淘汰） ===" << std::endl;
+    const int CAPACITY = 1 << 16;
+    const int KEY_SPACE = CAPACITY * 8;
+    const size_t OPS = 2000000;
+    int slices = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int threads : threadCounts()) {
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, slices);
+            printRow("LRU std::allocator", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            // 每个分片：无锁内存池（分片锁保证串行访问）-> 计数资源 -> 全局 new
+            std::vector<std::unique_ptr<KamaCache::KCountingResource>> counters;
+            std::vector<std::unique_ptr<std::pmr::unsynchronized_pool_resource>> pools;
+            for (int i = 0; i < slices; ++i) {
+                counters.emplace_back(new KamaCache::KCountingResource());
+                pools.emplace_back(new std::pmr::unsynchronized_pool_resource(counters.back().get()));
+            }
+            {
+                KamaCache::KHashLruCaches<int, int, KamaCache::KPmrAlloc> cache(
+                    CAPACITY, slices, [&](int i) { return KamaCache::KPmrAlloc(pools[i].get()); });
+                printRow("LRU 分片内存池", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+            }
+            if (threads == 1) {
+                std::cout << "  每个分片向上游申请的峰值内存:";
+                for (auto& counter : counters) std::cout << " " << counter->peakBytes() / 1024 << "KB";
+                std::cout << std::endl;
+            }
+        }
+        {
+            KamaCache::KHashLfuCache<int, int> cache(CAPACITY, slices, 1 << 20);
+            printRow("LFU std::allocator", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            std::vector<std::unique_ptr<std::pmr::unsynchronized_pool_resource>> pools;
+            for (int i = 0; i < slices; ++i) pools.emplace_back(new std::pmr::unsynchronized_pool_resource());
+            KamaCache::KHashLfuCache<int, int, KamaCache::KPmrAlloc> cache(
+                CAPACITY, slices, 1 << 20, [&](int i) { return KamaCache::KPmrAlloc(pools[i].get()); });
+            printRow("LFU 分片内存池", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+    }
+}
+
+void benchFlatCombining() {
+    std::cout << "\n=== 平面合并：所有访问落在同一个分片（Zipf 0.99，旁路缓存），线程数超过 CPU 核数时也运行 ===" << std::endl;
+    const int CAPACITY = 1 << 14;
+    const int KEY_SPACE = CAPACITY * 4;
+    const size_t OPS = 1000000;
+
+    std::vector<int> counts = threadCounts();
+    for (int threads : {2, 4, 8, 16}) {
+        if (threads > counts.back()) counts.push_back(threads);
+    }
+    for (int threads : counts) {
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, 1);
+            printRow("KHashLruCaches(1 slice)", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            KamaCache::KFlatCombiningLruCache<int, int> cache(CAPACITY);
+            printRow("KFlatCombiningLruCache", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+            std::cout << "  平均每批合并请求数: " << std::setprecision(2)
+                      << static_cast<double>(cache.combinedRequests()) / std::max<size_t>(1, cache.combinedBatches())
+                      << std::endl;
+        }
+    }
+}
+
+// threads 个线程共用一份访问序列（各自从不同的位置开始），总操作数固定为 totalOps，线程很多时不必为每个线程生成序列
+template <typename Cache>
+BenchResult runShared(Cache& cache, int threads, size_t totalOps, const std::vector<int>& trace) {
+    size_t opsPerThread = totalOps / threads;
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<size_t> hits{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            ++ready;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            size_t localHits = 0, offset = t * 7919;
+            int value = 0;
+            for (size_t i = 0; i < opsPerThread; ++i) {
+                int key = trace[(offset + i) & (trace.size() - 1)];
+                if (cache.get(key, value)) {
+                    ++localHits;
+                } else {
+                    cache.put(key, key);
+                }
+            }
+            hits += localHits;
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double ops = static_cast<double>(opsPerThread) * threads;
+    return {ops / seconds / 1e6, hits.load() / ops};
+}
+
+void benchLocks() {
+    std::cout << "\n=== 分片锁：std::mutex、自旋后挂起、MCS 队列锁，单个热点分片上 1-128 个线程（Zipf 0.99，旁路缓存） ==="
+              << std::endl;
+    const int CAPACITY = 1 << 14;
+    const size_t TOTAL_OPS = 2000000;
+    std::vector<int> trace = makeZipfTrace(CAPACITY * 4, 1 << 20, 0.99, 100);
+
+    for (int threads = 1; threads <= 128; threads *= 2) {
+        {
+            KamaCache::KHashLruCaches<int, int, KamaCache::KDefaultAlloc, std::mutex> cache(CAPACITY, 1);
+            printRow("LRU std::mutex", threads, runShared(cache, threads, TOTAL_OPS, trace));
+        }
+        {
+            KamaCache::KHashLruCaches<int, int, KamaCache::KDefaultAlloc, KamaCache::KSpinParkMutex> cache(CAPACITY, 1);
+            printRow("LRU KSpinParkMutex", threads, runShared(cache, threads, TOTAL_OPS, trace));
+        }
+        {
+            KamaCache::KHashLruCaches<int, int, KamaCache::KDefaultAlloc, KamaCache::KMcsMutex> cache(CAPACITY, 1);
+            printRow("LRU KMcsMutex", threads, runShared(cache, threads, TOTAL_OPS, trace));
+        }
+        {
+            KamaCache::KFlatCombiningLruCache<int, int, KamaCache::KSpinParkMutex> cache(CAPACITY);
+            printRow("FC KSpinParkMutex", threads, runShared(cache, threads, TOTAL_OPS, trace));
+        }
+    }
+}
+
+void benchPromotion() {
+    std::cout << "\n=== LRU 提升方式：热点 key 全部命中时的并发 get（单分片，Zipf 0.99） ===" << std::endl;
+    const int CAPACITY = 1 << 14;
+    const size_t TOTAL_OPS = 2000000;
+    // key 空间小于容量，预热后每次 get 都命中，开销只来自命中时的提升
+    std::vector<int> trace = makeZipfTrace(CAPACITY / 2, 1 << 20, 0.99, 100);
+    std::vector<std::pair<const char*, KamaCache::KLruPromotion>> modes = {
+        {"LRU Eager", KamaCache::KLruPromotion::Eager},
+        {"LRU Reinsertion", KamaCache::KLruPromotion::Reinsertion},
+        {"LRU Throttled(1ms)", KamaCache::KLruPromotion::Throttled},
+    };
+
+    std::vector<int> counts = threadCounts();
+    if (counts.back() < 8) counts.push_back(8);
+    for (int threads : counts) {
+        for (const auto& mode : modes) {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, 1);
+            cache.setPromotion(mode.second);
+            for (int key = 0; key < CAPACITY / 2; ++key) cache.put(key, key);
+            printRow(mode.first, threads, runShared(cache, threads, TOTAL_OPS, trace));
+        }
+    }
+}
+
+// 在线调整分片数：访问持续进行，分别统计调整前、迁移期间、调整后的吞吐与命中率
+template <typename Cache>
+void runReshardCase(const std::string& name, Cache& cache, int threads, int fromSlices, int toSlices,
+                    const std::vector<int>& trace) {
+    for (int key : trace) cache.put(key, key);  // 预热
+
+    enum Phase { kBefore, kMigrating, kAfter, kPhases };
+    std::atomic<int> phase{kBefore};
+    std::atomic<bool> stop{false};
+    std::vector<std::atomic<size_t>> ops(kPhases), hits(kPhases);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            size_t i = t * 7919;
+            int value = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int current = phase.load(std::memory_order_relaxed);
+                size_t localOps = 0, localHits = 0;
+                for (int n = 0; n < 1024; ++n, ++i, ++localOps) {
+                    int key = trace[i & (trace.size() - 1)];
+                    if (cache.get(key, value)) {
+                        ++localHits;
+                    } else {
+                        cache.put(key, key);
+                    }
+                }
+                ops[current] += localOps;
+                hits[current] += localHits;
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto migrationStart = std::chrono::steady_clock::now();
+    phase = kMigrating;
+    cache.reshard(toSlices);
+    while (cache.resharding()) std::this_thread::sleep_for(std::chrono::microseconds(100));
+    auto migrationEnd = std::chrono::steady_clock::now();
+    phase = kAfter;
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop = true;
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds[kPhases] = {std::chrono::duration<double>(migrationStart - start).count(),
+                               std::chrono::duration<double>(migrationEnd - migrationStart).count(),
+                               std::chrono::duration<double>(end - migrationEnd).count()};
+    const char* labels[kPhases] = {"调整前", "迁移中", "调整后"};
+    std::cout << name << " " << fromSlices << " -> " << toSlices << " 分片，迁移耗时 " << std::fixed << std::setprecision(1)
+              << seconds[kMigrating] * 1000 << " ms" << std::endl;
+    for (int p = 0; p < kPhases; ++p) {
+        double n = std::max<double>(1, ops[p].load());
+        printRow(std::string("  ") + labels[p], threads, {n / seconds[p] / 1e6, hits[p].load() / n});
+    }
+}
+
+void benchReshard() {
+    std::cout << "\n=== 在线调整分片数：100 万个元素的缓存在访问进行中扩容与缩容（Zipf 0.99，旁路缓存） ===" << std::endl;
+    const int CAPACITY = 1 << 20;
+    std::vector<int> trace = makeZipfTrace(CAPACITY * 4, 1 << 22, 0.99, 100);
+    int threads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (auto slices : {std::make_pair(4, 16), std::make_pair(16, 4)}) {
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, slices.first);
+            runReshardCase("KHashLruCaches", cache, threads, slices.first, slices.second, trace);
+        }
+        {
+            KamaCache::KHashLfuCache<int, int> cache(CAPACITY, slices.first);
+            runReshardCase("KHashLfuCache", cache, threads, slices.first, slices.second, trace);
+        }
+    }
+}
+
+void benchSeededHash() {
+    std::cout << "\n=== 带种子的分片哈希：吞吐开销（Zipf 0.99，旁路缓存） ===" << std::endl;
+    const int CAPACITY = 1 << 16;
+    const int KEY_SPACE = CAPACITY * 4;
+    const size_t OPS = 2000000;
+
+    for (int threads : threadCounts()) {
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, 8);
+            printRow("LRU std::hash", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, 8);
+            cache.setHashSeed();
+            cache.waitForReshard();
+            printRow("LRU KSeededHash", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+        {
+            KamaCache::KHashLruCaches<int, int> cache(CAPACITY, 8);
+            cache.enableSkewDetection();
+            printRow("LRU std::hash + skew check", threads, runThroughput(cache, threads, OPS, KEY_SPACE));
+        }
+    }
+}
+
+// 当前线程用户态的 dTLB 读未命中次数（perf_event_open），内核或虚拟机不提供该事件时不可用
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~DtlbMissCounter() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    bool available() const { return fd_ >= 0; }
+
+    void start() {
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64_t stop() {
+        uint64_t count = 0;
+        if (fd_ < 0) return 0;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd_, &count, sizeof(count)) != sizeof(count)) count = 0;
+        return count;
+    }
+
+private:
+    int fd_;
+};
+
+// 进程中由透明大页支撑的匿名内存（KB），读取失败返回 -1
+long anonHugePagesKB() {
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string line;
+    const std::string field = "AnonHugePages:";
+    while (std::getline(in, line)) {
+        if (line.compare(0, field.size(), field) == 0) return std::stol(line.substr(field.size()));
+    }
+    return -1;
+}
+
+// 单线程：随机查询已有的 key（一半不存在），再随机写入新 key 触发淘汰，统计吞吐与每次操作的 dTLB 未命中
+template <typename Cache>
+void runHugePageCase(const std::string& name, Cache& cache, int capacity) {
+    const size_t OPS = 1 << 22;
+    for (int i = 0; i < capacity; ++i) cache.put(i * 2, i);
+    std::mt19937 gen(capacity);
+    std::uniform_int_distribution<int> dist(0, capacity * 2 - 1);
+    std::vector<int> keys(OPS);
+    for (auto& key : keys) key = dist(gen);
+
+    DtlbMissCounter counter;
+    int value = 0;
+    size_t hits = 0;
+    counter.start();
+    auto start = std::chrono::steady_clock::now();
+    for (int key : keys) hits += cache.get(key, value);
+    double getSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t getMisses = counter.stop();
+
+    counter.start();
+    start = std::chrono::steady_clock::now();
+    for (int key : keys) cache.put(key * 2 + 1, key);  // 全部是新 key，每次写入淘汰一个结点
+    double putSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t putMisses = counter.stop();
+
+    std::cout << std::left << std::setw(24) << name << std::right << std::setw(10) << capacity << std::fixed
+              << std::setprecision(2) << std::setw(10) << OPS / getSeconds / 1e6 << std::setw(10)
+              << OPS / putSeconds / 1e6 << " Mops/s";
+    if (counter.available()) {
+        std::cout << std::setw(10) << static_cast<double>(getMisses) / OPS << std::setw(10)
+                  << static_cast<double>(putMisses) / OPS;
+    } else {
+        std::cout << std::setw(10) << "n/a" << std::setw(10) << "n/a";
+    }
+    long thp = anonHugePagesKB();
+    std::cout << std::setw(10) << (thp < 0 ? 0 : thp / 1024) << "MB" << std::setw(8) << 100.0 * hits / OPS << "%"
+              << std::endl;
+}
+
+void benchHugePages() {
+    std::cout << "\n=== 大页内存区：单线程 LRU 查询与写入吞吐、每次操作的 dTLB 未命中，缓存大小超过 LLC ===" << std::endl;
+    std::cout << std::left << std::setw(24) << "allocator" << std::right << std::setw(10) << "entries" << std::setw(10)
+              << "get" << std::setw(10) << "put" << std::setw(17) << "dTLB/get" << std::setw(10) << "dTLB/put"
+              << std::setw(12) << "THP" << std::endl;
+    for (int capacity : {1 << 21, 1 << 23}) {
+        {
+            KamaCache::KLruCache<int, int> cache(capacity);
+            runHugePageCase("std::allocator", cache, capacity);
+        }
+        {
+            KamaCache::KHugePageResource pages(false);
+            KamaCache::KLruCache<int, int, KamaCache::KPmrAlloc> cache(capacity, KamaCache::KPmrAlloc(&pages));
+            runHugePageCase("KHugePageResource(4KB)", cache, capacity);
+        }
+        {
+            KamaCache::KHugePageResource pages(true);
+            KamaCache::KLruCache<int, int, KamaCache::KPmrAlloc> cache(capacity, KamaCache::KPmrAlloc(&pages));
+            runHugePageCase("KHugePageResource(2MB)", cache, capacity);
+            std::cout << "  大页内存区映射 " << pages.mappedBytes() / (1 << 20) << "MB，其中 MAP_HUGETLB "
+                      << pages.hugeTlbBytes() / (1 << 20) << "MB，透明大页 "
+                      << pages.advisedBytes() / (1 << 20) << "MB" << std::endl;
+        }
+    }
+    if (!DtlbMissCounter().available()) std::cout << "  （当前环境不提供 dTLB 性能计数器）" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    struct Section {
+        const char* name;
+        std::function<void()> run;
+    };
+    std::vector<Section> sections = {
+        {"setassoc", benchSetAssociative},
+        {"frozen", benchFrozenHotSet},
+        {"prefetch", benchPrefetchedLookup},
+        {"refresh", benchRefresh},
+        {"alloc", benchAllocator},
+        {"hugepage", benchHugePages},
+        {"combining", benchFlatCombining},
+        {"locks", benchLocks},
+        {"promotion", benchPromotion},
+        {"reshard", benchReshard},
+        {"seeded", benchSeededHash},
+    };
+
+    for (const Section& section : sections) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) selected |= std::strcmp(argv[i], section.name) == 0;
+        if (selected) section.run();
+    }
+    return 0;
+}
@@ -1,13 +1,34 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "KAdmissionFilter.h"
 #include "KArcCache/KArcCache.h"
+#include "KCacheBudget.h"
+#include "KGreedyDualCache.h"
 #include "KICachePolicy.h"
+#include "KInvalidationBus.h"
 #include "KLfuCache.h"
 #include "KLruCache.h"
+#include "KMemoryGovernor.h"
+#include "KScanDetector.h"
+#include "KShmCache.h"
+#include "KTenantLruCache.h"
 
 // 辅助函数：打印结果
 void printResults(const std::string& testName,
@@ -189,9 +210,698 @@ void testWorkloadShift() {
     printResults("工作负载剧烈变化测试", CAPACITY, get_operations, hits);
 }
 
+void testAdmissionFilter() {
+    std::cout << "\n=== 测试场景4：布隆过滤器准入测试 ===" << std::endl;
+
+    const int CAPACITY = 100;
+    const int OPERATIONS = 500000;
+    const int HOT_KEYS = 80;
+    const int COLD_KEYS = 50000;
+
+    // 旁路缓存模式：未命中时回源并写入缓存。30% 的冷数据每次写入都会淘汰一个元素
+    KamaCache::KLruCache<int, std::string> lru(CAPACITY);
+    KamaCache::KLruCache<int, std::string> lruBloom(CAPACITY);
+    lruBloom.setAdmissionFilter(std::make_shared<KamaCache::KBloomAdmissionFilter>(CAPACITY * 10));
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    std::array<KamaCache::KLruCache<int, std::string>*, 2> caches = {&lru, &lruBloom};
+    std::vector<int> hits(2, 0);
+    std::vector<int> get_operations(2, 0);
+
+    for (int i = 0; i < caches.size(); ++i) {
+        for (int op = 0; op < OPERATIONS; ++op) {
+            int key = (op % 100 < 70) ? gen() % HOT_KEYS : HOT_KEYS + (gen() % COLD_KEYS);
+            std::string result;
+            get_operations[i]++;
+            if (caches[i]->get(key, result)) {
+                hits[i]++;
+            } else {
+                caches[i]->put(key, "value" + std::to_string(key));
+            }
+        }
+    }
+
+    std::cout << "缓存大小: " << CAPACITY << std::endl;
+    std::cout << "LRU - 命中率: " << std::fixed << std::setprecision(2) << (100.0 * hits[0] / get_operations[0]) << "%"
+              << std::endl;
+    std::cout << "LRU+Bloom准入 - 命中率: " << std::fixed << std::setprecision(2)
+              << (100.0 * hits[1] / get_operations[1]) << "%" << std::endl;
+
+    // 整数 key 的 std::hash 是恒等映射：窗口写到 90% 后，再用从未出现过的整数 key 测误判率
+    const int WINDOW = 10000;
+    KamaCache::KBloomAdmissionFilter filter(WINDOW);
+    std::mt19937 keyGen(12345);
+    auto randomKeyHash = [&] { return KamaCache::KLruCache<int, int>::keyHash(static_cast<int>(keyGen() >> 1)); };
+    for (int i = 0; i < WINDOW * 9 / 10; ++i) filter.admit(randomKeyHash());
+    int probes = WINDOW / 10 - 1, falsePositives = 0;
+    for (int i = 0; i < probes; ++i) falsePositives += filter.admit(randomKeyHash());
+    double falsePositiveRate = 100.0 * falsePositives / probes;
+    std::cout << "整数 key 的误判率（窗口已写入 90%）: " << std::fixed << std::setprecision(2) << falsePositiveRate
+              << "%" << std::endl;
+    assert(falsePositiveRate < 3.0);
+}
+
+void testScanResistance() {
+    std::cout << "\n=== 测试场景5：顺序扫描检测测试 ===" << std::endl;
+
+    const int CAPACITY = 100;
+    const int OPERATIONS = 200000;
+    const int HOT_KEYS = 80;
+    const int SCAN_BASE = 1000000;
+
+    // 旁路缓存模式，每 1000 次访问中有 300 次来自顺序遍历 key 的批处理任务，只统计热点访问的命中率
+    KamaCache::KHashLruCaches<int, std::string> plain(CAPACITY, 1);
+    KamaCache::KHashLruCaches<int, std::string> cold(CAPACITY, 1);
+    cold.setScanDetector(std::make_shared<KamaCache::KScanDetector<int>>(16, KamaCache::KScanPolicy::InsertCold));
+    KamaCache::KHashLruCaches<int, std::string> bypass(CAPACITY, 1);
+    bypass.setScanDetector(std::make_shared<KamaCache::KScanDetector<int>>(16, KamaCache::KScanPolicy::Bypass));
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    std::array<KamaCache::KHashLruCaches<int, std::string>*, 3> caches = {&plain, &cold, &bypass};
+    std::vector<int> hits(3, 0);
+    std::vector<int> get_operations(3, 0);
+
+    for (int i = 0; i < caches.size(); ++i) {
+        int scanPos = 0;
+        for (int op = 0; op < OPERATIONS; ++op) {
+            bool scan = op % 1000 < 300;
+            int key = scan ? SCAN_BASE + scanPos++ : gen() % HOT_KEYS;
+            std::string result;
+            bool hit = caches[i]->get(key, result);
+            if (!hit) caches[i]->put(key, "value" + std::to_string(key));
+            if (!scan) {
+                get_operations[i]++;
+                if (hit) hits[i]++;
+            }
+        }
+    }
+
+    std::cout << "缓存大小: " << CAPACITY << std::endl;
+    std::cout << "LRU - 热点命中率: " << std::fixed << std::setprecision(2) << (100.0 * hits[0] / get_operations[0])
+              << "%" << std::endl;
+    std::cout << "LRU+扫描冷插入 - 热点命中率: " << std::fixed << std::setprecision(2)
+              << (100.0 * hits[1] / get_operations[1]) << "%" << std::endl;
+    std::cout << "LRU+扫描绕过 - 热点命中率: " << std::fixed << std::setprecision(2)
+              << (100.0 * hits[2] / get_operations[2]) << "%" << std::endl;
+
+    // 在两个相邻的热点 key 之间来回访问不是扫描；一直递增的访问是扫描，包括到达 INT64_MAX 时
+    KamaCache::KScanDetector<int64_t> detector(16);
+    int alternating = 0, ascending = 0;
+    for (int i = 0; i < 100; ++i) alternating += detector.observe(5 + i % 2);
+    for (int64_t key = INT64_MAX - 99; key != INT64_MIN; ++key) {
+        ascending += detector.observe(key);
+        if (key == INT64_MAX) break;
+    }
+    std::cout << "交替访问 5、6 被判为扫描: " << alternating << "/100 次，递增到 INT64_MAX 被判为扫描: " << ascending
+              << "/100 次" << std::endl;
+}
+
+void testCostAwareEviction() {
+    std::cout << "\n=== 测试场景6：代价感知淘汰测试 ===" << std::endl;
+
+    const int CAPACITY = 100;
+    const int OPERATIONS = 200000;
+    const int KEYS = 500;
+    const double CHEAP_COST = 2;       // 如 2ms 即可重新计算
+    const double EXPENSIVE_COST = 200;  // 如 200ms 才能重新计算
+
+    // 旁路缓存模式，key 均匀访问，每 10 个 key 中有 1 个重新计算的代价高出 100 倍，统计未命中代价之和
+    KamaCache::KLruCache<int, std::string> lru(CAPACITY);
+    KamaCache::KLfuCache<int, std::string> lfu(CAPACITY);
+    KamaCache::KGreedyDualCache<int, std::string> greedyDual(CAPACITY);
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    std::array<KamaCache::KICachePolicy<int, std::string>*, 3> caches = {&lru, &lfu, &greedyDual};
+    std::vector<int> hits(3, 0);
+    std::vector<double> penalty(3, 0);
+
+    for (int i = 0; i < caches.size(); ++i) {
+        for (int op = 0; op < OPERATIONS; ++op) {
+            int key = gen() % KEYS;
+            double cost = key % 10 == 0 ? EXPENSIVE_COST : CHEAP_COST;
+            std::string result;
+            if (caches[i]->get(key, result)) {
+                hits[i]++;
+                continue;
+            }
+            penalty[i] += cost;
+            if (caches[i] == &greedyDual) {
+                greedyDual.put(key, "value" + std::to_string(key), cost);
+            } else {
+                caches[i]->put(key, "value" + std::to_string(key));
+            }
+        }
+    }
+
+    std::cout << "缓存大小: " << CAPACITY << std::endl;
+    const char* names[] = {"LRU", "LFU", "GreedyDual"};
+    for (int i = 0; i < 3; ++i) {
+        std::cout << names[i] << " - 命中率: " << std::fixed << std::setprecision(2) << (100.0 * hits[i] / OPERATIONS)
+                  << "%, 未命中代价之和: " << std::setprecision(0) << penalty[i] << std::endl;
+    }
+}
+
+void testTenantQuota() {
+    std::cout << "\n=== 测试场景7：多租户配额测试 ===" << std::endl;
+
+    const int CAPACITY = 100;
+    const int OPERATIONS = 200000;
+    const int HOT_KEYS = 60;         // 租户 1 的热点数据
+    const int NOISY_KEYS = 100000;  // 租户 2 随机访问大量 key
+    const uint32_t QUIET = 1, NOISY = 2;
+
+    // 旁路缓存模式，两个租户交替访问，统计租户 1 的命中率
+    KamaCache::KLruCache<int, std::string> shared(CAPACITY);
+    KamaCache::KTenantLruCache<int, std::string> partitioned(CAPACITY);
+    partitioned.setQuota(QUIET, 70);
+    partitioned.setQuota(NOISY, 30);
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    int sharedHits = 0, quietGets = 0;
+    for (int op = 0; op < OPERATIONS; ++op) {
+        bool quiet = op % 2 == 0;
+        int key = quiet ? gen() % HOT_KEYS : HOT_KEYS + gen() % NOISY_KEYS;
+        std::string result;
+        bool hit = shared.get(key, result);
+        if (!hit) shared.put(key, "value" + std::to_string(key));
+        if (quiet) {
+            quietGets++;
+            if (hit) sharedHits++;
+        }
+
+        uint32_t tenant = quiet ? QUIET : NOISY;
+        if (!partitioned.get(tenant, key, result)) partitioned.put(tenant, key, "value" + std::to_string(key));
+    }
+
+    KamaCache::KTenantStats quietStats = partitioned.stats(QUIET);
+    KamaCache::KTenantStats noisyStats = partitioned.stats(NOISY);
+    std::cout << "缓存大小: " << CAPACITY << std::endl;
+    std::cout << "共享LRU - 租户1命中率: " << std::fixed << std::setprecision(2) << (100.0 * sharedHits / quietGets)
+              << "%" << std::endl;
+    std::cout << "多租户LRU - 租户1命中率: " << std::fixed << std::setprecision(2)
+              << (100.0 * quietStats.hits / (quietStats.hits + quietStats.misses)) << "%" << std::endl;
+    std::cout << "多租户LRU - 租户2占用: " << noisyStats.size << "（配额 " << noisyStats.quota << "，借用 "
+              << noisyStats.borrowed() << "）, 被淘汰: " << noisyStats.evictions << std::endl;
+
+    // 两个租户借用了空闲配额，配额以内的租户写入时每次从借用最多的租户收回一个，最后两者借用相同
+    const uint32_t BORROWER_A = 3, BORROWER_B = 4, OWNER = 5;
+    KamaCache::KTenantLruCache<int, int> borrowing(10);
+    borrowing.setQuota(OWNER, 10);
+    for (int key = 0; key < 3; ++key) borrowing.put(BORROWER_A, key, key);
+    for (int key = 10; key < 15; ++key) borrowing.put(BORROWER_B, key, key);
+    for (int key = 20; key < 26; ++key) borrowing.put(OWNER, key, key);
+    int value;
+    borrowing.get(999, 20, value);  // 未知租户的读取不创建租户
+    std::cout << "借用收回 - 租户A借用: " << borrowing.stats(BORROWER_A).borrowed()
+              << ", 租户B借用: " << borrowing.stats(BORROWER_B).borrowed()
+              << ", 配额内租户占用: " << borrowing.stats(OWNER).size << std::endl;
+    assert(borrowing.stats(BORROWER_A).borrowed() == 2 && borrowing.stats(BORROWER_B).borrowed() == 2);
+    assert(borrowing.stats(999).hits == 0);
+}
+
+// 带大块数据的 value：析构时调用 onDestroy 检查缓存的分片锁是否已经释放
+struct LargeValue {
+    std::vector<char> data;
+    static std::function<void()> onDestroy;
+
+    LargeValue() = default;
+    explicit LargeValue(size_t bytes) : data(bytes, 'x') {}
+    LargeValue(const LargeValue&) = default;
+    LargeValue& operator=(const LargeValue&) = default;
+    LargeValue(LargeValue&&) noexcept = default;
+    LargeValue& operator=(LargeValue&&) noexcept = default;
+
+    ~LargeValue() {
+        if (!data.empty() && onDestroy) onDestroy();
+    }
+};
+std::function<void()> LargeValue::onDestroy;
+
+// 另一个线程查询缓存，100ms 内返回说明锁没有被持有。查询线程分离运行，锁内析构时不会死锁
+template <typename Cache>
+bool lockIsFree(Cache& cache) {
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> finished = done->get_future();
+    std::thread([&cache, done] {
+        LargeValue value;
+        cache.get(-1, value);
+        done->set_value();
+    }).detach();
+    return finished.wait_for(std::chrono::milliseconds(100)) == std::future_status::ready;
+}
+
+void testDeferredRelease() {
+    std::cout << "\n=== 测试场景8：被淘汰、覆盖与删除的大 value 在解锁后析构 ===" << std::endl;
+
+    const int CAPACITY = 4;
+    const size_t VALUE_BYTES = 4 << 20;
+
+    KamaCache::KLruCache<int, LargeValue> lru(CAPACITY);
+    KamaCache::KLfuCache<int, LargeValue> lfu(CAPACITY);
+
+    auto run = [&](const std::string& name, auto& cache) {
+        int inside = 0, outside = 0;
+        LargeValue::onDestroy = [&] { lockIsFree(cache) ? ++outside : ++inside; };
+        for (int key = 0; key < CAPACITY * 2; ++key) cache.put(key, LargeValue(VALUE_BYTES));  // 淘汰
+        for (int key = CAPACITY; key < CAPACITY * 2; ++key) cache.put(key, LargeValue(VALUE_BYTES));  // 覆盖
+        cache.remove(CAPACITY);                                                                  // 删除
+        cache.purge();
+        LargeValue::onDestroy = nullptr;
+        std::cout << name << " - 锁外析构: " << outside << ", 锁内析构: " << inside << std::endl;
+    };
+    run("LRU", lru);
+    run("LFU", lfu);
+}
+
+void testOnlineReshard() {
+    std::cout << "\n=== 测试场景9：访问进行中调整分片数 ===" << std::endl;
+
+    const int CAPACITY = 100000;
+    const int KEY_SPACE = 20000;
+
+    KamaCache::KHashLruCaches<int, int> lru(CAPACITY, 4);
+    KamaCache::KHashLfuCache<int, int> lfu(CAPACITY, 4);
+
+    auto run = [&](const std::string& name, auto& cache) {
+        // 一个线程持续覆盖写入，另一个线程持续读取，其间把分片数依次调整为 7、2、5
+        std::vector<int> latest(KEY_SPACE);
+        for (int key = 0; key < KEY_SPACE; ++key) cache.put(key, latest[key] = key);
+        std::atomic<bool> stop{false};
+        std::thread writer([&] {
+            std::mt19937 gen(1);
+            for (int version = KEY_SPACE; !stop; ++version) {
+                int key = gen() % KEY_SPACE;
+                cache.put(key, latest[key] = version);
+            }
+        });
+        std::thread reader([&] {
+            std::mt19937 gen(2);
+            int value;
+            while (!stop) cache.get(gen() % KEY_SPACE, value);
+        });
+        for (int sliceNum : {7, 2, 5}) {
+            cache.reshard(sliceNum);
+            cache.waitForReshard();
+        }
+        stop = true;
+        writer.join();
+        reader.join();
+
+        int missing = 0, stale = 0, value;
+        for (int key = 0; key < KEY_SPACE; ++key) {
+            if (!cache.get(key, value)) {
+                ++missing;
+            } else if (value != latest[key]) {
+                ++stale;
+            }
+        }
+        std::cout << name << " - 分片数: " << cache.sliceNum() << ", 丢失: " << missing << ", 旧值: " << stale
+                  << std::endl;
+    };
+    run("LRU", lru);
+    run("LFU", lfu);
+}
+
+void testSeededSharding() {
+    std::cout << "\n=== 测试场景10：构造的 key 集中到同一个分片 ===" << std::endl;
+
+    const int CAPACITY = 4000;
+    const int SLICES = 4;
+    const size_t KEYS = 3000;
+    const int ROUNDS = 20;
+
+    // 不带种子时分片由 std::hash（整数为恒等映射）决定，可以直接挑出全部落在 0 号分片的 key
+    std::vector<int> keys;
+    for (int key = 0; keys.size() < KEYS; ++key) {
+        if (KamaCache::jumpConsistentHash(std::hash<int>{}(key), SLICES) == 0) keys.push_back(key);
+    }
+
+    enum class Mode { Unseeded, Seeded, SkewDetection };
+    auto run = [&](const std::string& name, Mode mode) {
+        KamaCache::KHashLruCaches<int, int> cache(CAPACITY, SLICES);
+        if (mode == Mode::Seeded) cache.setHashSeed();
+        if (mode == Mode::SkewDetection) cache.enableSkewDetection(2.0, 8192);
+        size_t hits = 0, lookups = 0;
+        int value;
+        for (int round = 0; round < ROUNDS; ++round) {
+            for (int key : keys) {
+                ++lookups;
+                if (cache.get(key, value)) {
+                    ++hits;
+                } else {
+                    cache.put(key, key);
+                }
+            }
+        }
+        std::cout << name << " - 命中率: " << std::fixed << std::setprecision(2) << 100.0 * hits / lookups
+                  << "%, 自动换种子次数: " << cache.skewReseeds() << std::endl;
+    };
+    run("不带种子", Mode::Unseeded);
+    run("随机种子", Mode::Seeded);
+    run("倾斜检测", Mode::SkewDetection);
+}
+
+void testMemoryGovernor() {
+    std::cout << "\n=== 测试场景11：内存压力下收缩缓存，压力消失后扩回 ===" << std::endl;
+
+    // 用构造的 PSI 与 cgroup 文件模拟内存压力，用模拟的时钟调用 poll
+    std::string dir = std::filesystem::temp_directory_path() / ("kcache_governor_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir);
+    auto writeFiles = [&](double someAvg10, uint64_t current, uint64_t inactiveFile) {
+        std::ofstream(dir + "/pressure") << "some avg10=" << someAvg10 << " avg60=0.00 avg300=0.00 total=0\n"
+                                         << "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+        std::ofstream(dir + "/memory.current") << current << "\n";
+        std::ofstream(dir + "/memory.max") << (1 << 30) << "\n";
+        std::ofstream(dir + "/memory.stat") << "anon " << current - inactiveFile << "\ninactive_file " << inactiveFile
+                                            << "\n";
+    };
+
+    KamaCache::KMemoryGovernorOptions options;
+    options.pressurePath = dir + "/pressure";
+    options.cgroupPath = dir;
+    KamaCache::KMemoryGovernor governor(options);
+
+    KamaCache::KHashLruCaches<int, int> sharded(1000, 4);
+    KamaCache::KLruCache<int, int> single(200);
+    governor.add(sharded);
+    governor.add(single);
+
+    const char* actions[] = {"保持", "收缩", "扩回"};
+    struct Step {
+        const char* name;
+        int second;  // 模拟时钟
+        double someAvg10;
+        uint64_t current;
+        uint64_t inactiveFile;
+    };
+    // 连续三次读到同一次压力（PSI avg10 滞后）只收缩一次；用量高但大部分是可回收的页缓存时不收缩
+    auto start = KamaCache::KMemoryGovernor::Clock::now();
+    for (const Step& step : {Step{"PSI some 25%", 0, 25, 100 << 20, 0}, Step{"PSI some 25%", 1, 25, 100 << 20, 0},
+                             Step{"PSI some 25%", 2, 25, 100 << 20, 0},
+                             Step{"用量 95%，其中页缓存 40%", 11, 0, 970 << 20, 400 << 20},
+                             Step{"用量 95%", 12, 0, 970 << 20, 0}, Step{"PSI some 5%", 13, 5, 100 << 20, 0},
+                             Step{"无压力", 14, 0, 100 << 20, 0}, Step{"无压力", 15, 0, 100 << 20, 0},
+                             Step{"无压力", 16, 0, 100 << 20, 0}}) {
+        writeFiles(step.someAvg10, step.current, step.inactiveFile);
+        auto action = governor.poll(start + std::chrono::seconds(step.second));
+        std::cout << "第 " << step.second << " 秒 " << step.name << " - " << actions[static_cast<int>(action)]
+                  << ", 比例: " << std::fixed << std::setprecision(2) << governor.scale()
+                  << ", 分片LRU容量: " << sharded.capacity() << ", LRU容量: " << single.capacity() << std::endl;
+    }
+    std::filesystem::remove_all(dir);
+}
+
+void testMemoryBudget() {
+    std::cout << "\n=== 测试场景12：多个缓存共享全局内存预算 ===" << std::endl;
+
+    // 三类数据：user 在 1500 个 key 中随机访问，session 在 300 个 key 中随机访问，log 每次都是新 key、写入后不再读取。
+    // 未命中时写入（cache-aside），value 为 200 字节的字符串
+    const std::string payload(200, 'x');
+    const int rounds = 150000;
+    const int totalEntries = 2000;  // 三个缓存合计能放下的元素个数
+
+    // 用一个不设上限的预算量出每个元素的字节数
+    auto probe = std::make_shared<KamaCache::KCacheBudget>(SIZE_MAX);
+    size_t entryBytes = 0;
+    {
+        KamaCache::KLruCache<int, std::string> cache(1);
+        cache.setMemoryBudget(probe);
+        cache.put(0, payload);
+        entryBytes = probe->used();
+    }
+
+    auto run = [&](KamaCache::KLruCache<int, std::string>& user, KamaCache::KLfuCache<int, std::string>& session,
+                   KamaCache::KLruCache<int, std::string>& log) {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> userKey(0, 1499), sessionKey(0, 299);
+        int userHits = 0, sessionHits = 0;
+        std::string value;
+        for (int i = 0; i < rounds; ++i) {
+            int key = userKey(gen);
+            if (user.get(key, value)) {
+                ++userHits;
+            } else {
+                user.put(key, payload);
+            }
+            key = sessionKey(gen);
+            if (session.get(key, value)) {
+                ++sessionHits;
+            } else {
+                session.put(key, payload);
+            }
+            log.put(i, payload);
+        }
+        std::cout << "user 命中率: " << std::fixed << std::setprecision(2) << 100.0 * userHits / rounds
+                  << "%, session 命中率: " << 100.0 * sessionHits / rounds << "%" << std::endl;
+    };
+
+    std::cout << "每个元素约 " << entryBytes << " 字节，合计 " << totalEntries << " 个元素" << std::endl;
+    {
+        std::cout << "固定容量（每个缓存 " << totalEntries / 3 << " 个元素）: ";
+        KamaCache::KLruCache<int, std::string> user(totalEntries / 3), log(totalEntries / 3);
+        KamaCache::KLfuCache<int, std::string> session(totalEntries / 3, 1000);
+        run(user, session, log);
+    }
+    {
+        std::cout << "共享预算（容量不设限，合计不超过 " << totalEntries * entryBytes / 1024 << " KB）: ";
+        auto budget = std::make_shared<KamaCache::KCacheBudget>(totalEntries * entryBytes);
+        KamaCache::KLruCache<int, std::string> user(100000), log(100000);
+        KamaCache::KLfuCache<int, std::string> session(100000, 1000);
+        user.setMemoryBudget(budget, "user");
+        session.setMemoryBudget(budget, "session");
+        log.setMemoryBudget(budget, "log");
+        run(user, session, log);
+        for (const auto& stats : budget->stats()) {
+            std::cout << "  " << stats.name << ": 占用 " << stats.bytes / 1024 << " KB（" << stats.bytes / entryBytes
+                      << " 个元素）, 影子命中 " << stats.ghostHits << ", 被预算淘汰 " << stats.evictedBytes / 1024
+                      << " KB" << std::endl;
+        }
+        std::cout << "  合计 " << budget->used() / 1024 << " KB" << std::endl;
+    }
+}
+
+void testVersionedUpdate() {
+    std::cout << "\n=== 测试场景13：并发读-改-写同一批 key，期间调整分片数 ===" << std::endl;
+
+    // 4 个线程各对 64 个计数器加 1 共 20000 次，同时后台把分片数从 4 调整为 7 再调整为 3
+    const int threads = 4, increments = 20000, keys = 64;
+    auto run = [&](const char* name, bool versioned) {
+        KamaCache::KHashLruCaches<int, int> cache(10000, 4);
+        std::atomic<size_t> retries{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < increments; ++i) {
+                    int key = (i * 31 + t) % keys;
+                    int value = 0;
+                    if (!versioned) {
+                        cache.get(key, value);
+                        cache.put(key, value + 1);
+                        continue;
+                    }
+                    uint64_t version;
+                    while (true) {
+                        value = 0;
+                        cache.getWithVersion(key, value, version);
+                        if (cache.putIfVersion(key, value + 1, version)) break;
+                        ++retries;
+                    }
+                    if (i % 64 == 0) std::this_thread::yield();
+                }
+            });
+        }
+        for (int sliceNum : {7, 3}) {
+            while (!cache.reshard(sliceNum)) std::this_thread::yield();
+            cache.waitForReshard();
+        }
+        for (auto& worker : workers) worker.join();
+
+        long total = 0;
+        for (int key = 0; key < keys; ++key) total += cache.get(key);
+        std::cout << name << ": 计数合计 " << total << " / " << threads * increments << ", 重试 " << retries
+                  << " 次" << std::endl;
+    };
+    run("get + put", false);
+    run("getWithVersion + putIfVersion", true);
+}
+
+void testSharedMemoryCache() {
+    std::cout << "\n=== 测试场景14：多进程共享内存缓存 ===" << std::endl;
+
+    // 子进程写入，父进程读取
+    const std::string name = "/kcache_test_" + std::to_string(::getpid());
+    KamaCache::KShmCache<int, int>::unlink(name);
+    const int capacity = 1024, keys = 500;
+    KamaCache::KShmCache<int, int> cache(name, capacity, 4);
+    pid_t writer = ::fork();
+    if (writer == 0) {
+        KamaCache::KShmCache<int, int> child(name, capacity, 4);
+        for (int key = 0; key < keys; ++key) child.put(key, key * 2);
+        ::_exit(0);
+    }
+    ::waitpid(writer, nullptr, 0);
+    int hits = 0;
+    for (int key = 0; key < keys; ++key) {
+        int value = -1;
+        if (cache.get(key, value) && value == key * 2) ++hits;
+    }
+    std::cout << "子进程写入 " << keys << " 个元素，父进程读到 " << hits << " 个" << std::endl;
+
+    // 子进程不停写入时被 SIGKILL，多半正持有某个分片的锁；之后父进程必须仍能加锁并读写
+    int attempts = 0;
+    while (cache.recoveredSlices() == 0 && attempts < 50) {
+        ++attempts;
+        pid_t holder = ::fork();
+        if (holder == 0) {
+            KamaCache::KShmCache<int, int> child(name, capacity, 4);
+            for (int i = 0;; ++i) child.put(i % (capacity * 4), i);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ::kill(holder, SIGKILL);
+        ::waitpid(holder, nullptr, 0);
+        for (int key = 0; key < keys; ++key) cache.put(key, key);
+    }
+    int intact = 0;
+    for (int key = 0; key < keys; ++key) intact += cache.get(key) == key;
+    std::cout << "持锁进程被杀后重置的分片: " << (cache.recoveredSlices() > 0 ? "至少 1 个" : "0 个")
+              << "，之后重新写入的 " << keys << " 个元素中读到 " << intact << " 个" << std::endl;
+    KamaCache::KShmCache<int, int>::unlink(name);
+}
+
+void testInvalidationBus() {
+    std::cout << "\n=== 测试场景15：跨进程失效通知 ===" << std::endl;
+
+    // 父进程持有两个近端缓存（分片与单实例）并各自订阅，子进程（同一份程序，std::hash 一致）发布失效的 key
+    const std::string name = "/kcache_bus_" + std::to_string(::getpid());
+    KamaCache::KInvalidationBus::unlink(name);
+    const size_t ringSize = 64;
+    KamaCache::KInvalidationBus bus(name, ringSize);
+    KamaCache::KInvalidationSubscriber subscriber(bus), singleSubscriber(bus);
+    KamaCache::KHashLruCaches<std::string, int> cache(1000, 4);
+    KamaCache::KLruCache<std::string, int> single(1000);
+    cache.enableHashIndex();
+    single.enableHashIndex();
+    const int keys = 200;
+    for (int i = 0; i < keys; ++i) {
+        cache.put("key" + std::to_string(i), i);
+        single.put("key" + std::to_string(i), i);
+    }
+
+    auto publishInChild = [&](int first, int last) {
+        pid_t publisher = ::fork();
+        if (publisher == 0) {
+            KamaCache::KInvalidationBus childBus(name);
+            KamaCache::KInvalidationPublisher batch(childBus, ringSize / 2);
+            for (int i = first; i < last; ++i) {
+                batch.invalidate(KamaCache::KLruCache<std::string, int>::keyHash("key" + std::to_string(i)));
+            }
+            batch.flush();
+            ::_exit(0);
+        }
+        ::waitpid(publisher, nullptr, 0);
+    };
+    auto resident = [&](auto& near) {
+        int count = 0;
+        int value;
+        for (int i = 0; i < keys; ++i) count += near.get("key" + std::to_string(i), value);
+        return count;
+    };
+
+    // 一批 30 个，不超过环的容量
+    publishInChild(0, 30);
+    size_t received = subscriber.poll(cache);
+    singleSubscriber.poll(single);
+    std::cout << "子进程失效 30 个 key：收到 " << received << " 条通知，缓存剩余 " << resident(cache) << " / " << keys
+              << "（单实例 " << resident(single) << "），溢出 " << subscriber.overflows() << " 次" << std::endl;
+
+    // 一次发布 100 个，超过环的容量：订阅者无法知道丢了哪些，只能清空近端缓存
+    publishInChild(30, 130);
+    subscriber.poll(cache);
+    singleSubscriber.poll(single);
+    std::cout << "子进程失效 100 个 key（环容量 " << ringSize << "）：缓存剩余 " << resident(cache) << " / " << keys
+              << "（单实例 " << resident(single) << "），溢出 " << subscriber.overflows() << " 次" << std::endl;
+    KamaCache::KInvalidationBus::unlink(name);
+}
+
+void testPromotionModes() {
+    std::cout << "\n=== 测试场景16：LRU 命中时的提升方式（旁路缓存，get 未命中时 put） ===" << std::endl;
+
+    // 与场景1-3相同的访问模式，每种模式使用相同的随机序列
+    struct Workload {
+        const char* name;
+        int capacity;
+        std::function<int(int, std::mt19937&)> next;
+    };
+    const int OPERATIONS = 200000;
+    std::vector<Workload> workloads = {
+        {"热点数据", 50, [](int op, std::mt19937& gen) -> int { return op % 100 < 70 ? gen() % 20 : 20 + gen() % 5000; }},
+        {"循环扫描", 50,
+         [](int op, std::mt19937& gen) -> int {
+             if (op % 100 < 60) return (op / 100 * 60 + op % 100) % 500;
+             return op % 100 < 90 ? gen() % 500 : 500 + gen() % 500;
+         }},
+        {"负载变化", 4, [&](int op, std::mt19937& gen) -> int {
+             const int phase = OPERATIONS / 5;
+             if (op < phase) return gen() % 5;
+             if (op < phase * 2) return gen() % 1000;
+             if (op < phase * 3) return (op - phase * 2) % 100;
+             if (op < phase * 4) return (op / 1000) % 10 * 20 + gen() % 20;
+             int r = gen() % 100;
+             return r < 30 ? gen() % 5 : r < 60 ? 5 + gen() % 95 : 100 + gen() % 900;
+         }},
+    };
+    std::vector<std::pair<const char*, KamaCache::KLruPromotion>> modes = {
+        {"Eager", KamaCache::KLruPromotion::Eager},
+        {"Reinsertion", KamaCache::KLruPromotion::Reinsertion},
+        {"Throttled", KamaCache::KLruPromotion::Throttled},
+    };
+
+    for (const Workload& workload : workloads) {
+        std::cout << workload.name << "（容量 " << workload.capacity << "）:";
+        for (const auto& mode : modes) {
+            KamaCache::KLruCache<int, int> cache(workload.capacity);
+            cache.setPromotion(mode.second);
+            std::mt19937 gen(42);
+            int hits = 0, value = 0;
+            for (int op = 0; op < OPERATIONS; ++op) {
+                int key = workload.next(op, gen);
+                if (cache.get(key, value)) {
+                    ++hits;
+                } else {
+                    cache.put(key, key);
+                }
+            }
+            std::cout << " " << mode.first << " " << std::fixed << std::setprecision(2) << 100.0 * hits / OPERATIONS
+                      << "%";
+        }
+        std::cout << std::endl;
+    }
+}
+
 int main() {
     testHotDataAccess();
     testLoopPattern();
     testWorkloadShift();
+    testAdmissionFilter();
+    testScanResistance();
+    testCostAwareEviction();
+    testTenantQuota();
+    testDeferredRelease();
+    testOnlineReshard();
+    testSeededSharding();
+    testMemoryGovernor();
+    testMemoryBudget();
+    testVersionedUpdate();
+    testSharedMemoryCache();
+    testInvalidationBus();
+    testPromotionModes();
     return 0;
 }
\ No newline at end of file